@@ -14,13 +14,41 @@
 #include "GameFramework/GameStateBase.h"
 #include "Gravity/Components/ShooterCombatComponent.h"
 #include "Gravity/Components/ShooterHealthComponent.h"
+#include "Gravity/Gravity.h"
+#include "Gravity/GravityStats.h"
 #include "Gravity/Flooring/FloorBase.h"
 #include "Gravity/Flooring/SphereFloorBase.h"
 #include "Gravity/Sphere/GravitySphere.h"
+#include "Gravity/Subsystems/GravityQuerySubsystem.h"
 #include "Gravity/Weapons/WeaponBase.h"
 #include "Kismet/GameplayStatics.h"
 #include "Kismet/KismetMathLibrary.h"
 #include "Net/UnrealNetwork.h"
+#include "VisualLogger/VisualLogger.h"
+
+#include <atomic>
+
+namespace BasePawnPlayer
+{
+	std::atomic<uint32> NumMovementSteps(0);
+	std::atomic<uint32> NumComponentTransformUpdates(0);
+}
+
+uint32 ABasePawnPlayer::GetNumMovementSteps()
+{
+	return BasePawnPlayer::NumMovementSteps.load(std::memory_order_relaxed);
+}
+
+uint32 ABasePawnPlayer::GetNumComponentTransformUpdates()
+{
+	return BasePawnPlayer::NumComponentTransformUpdates.load(std::memory_order_relaxed);
+}
+
+void ABasePawnPlayer::CountTransformUpdate(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	BasePawnPlayer::NumComponentTransformUpdates.fetch_add(1, std::memory_order_relaxed);
+	INC_DWORD_STAT(STAT_GravityComponentTransformUpdates);
+}
 
 ABasePawnPlayer::ABasePawnPlayer()
 {
@@ -72,6 +100,15 @@ ABasePawnPlayer::ABasePawnPlayer()
 	RightHand->SetupAttachment(Skeleton, FName("RightHand"));
 	LeftHand = CreateDefaultSubobject<UBoxComponent>(TEXT("LeftHand"));
 	LeftHand->SetupAttachment(Skeleton, FName("LeftHand"));
+	UBoxComponent* const AllHitBoxes[] = {
+		Head, Spine2, Hips,
+		RightUpLeg, LeftUpLeg, RightLeg, LeftLeg, RightFoot, LeftFoot,
+		RightArm, LeftArm, RightForeArm, LeftForeArm, RightHand, LeftHand };
+	static_assert(UE_ARRAY_COUNT(AllHitBoxes) == ShooterNumHitboxes, "every hit box needs a slot in the history");
+	for(int32 Box = 0; Box < ShooterNumHitboxes; Box++)
+	{
+		HitBoxes[Box] = AllHitBoxes[Box];
+	}
 }
 
 
@@ -105,6 +142,19 @@ void ABasePawnPlayer::BeginPlay()
 		Capsule->OnComponentHit.AddDynamic(this, &ABasePawnPlayer::OnFloorHit);
 	}
 	OnTakeAnyDamage.AddDynamic(this, &ABasePawnPlayer::PassDamageToHealth);
+	CaptureHitboxShapes();
+#if !UE_BUILD_SHIPPING
+	//counted for stat Gravity and the perf tests
+	TInlineComponentArray<USceneComponent*> SceneComponents(this);
+	for(USceneComponent* SceneComponent : SceneComponents)
+	{
+		SceneComponent->TransformUpdated.AddUObject(this, &ABasePawnPlayer::CountTransformUpdate);
+	}
+#endif
+	MovementSimulation = FShooterMovementSimulation(BuildMovementSettings());
+	SkeletonRelativeTransform = Skeleton->GetRelativeTransform();
+	PreviousSimTransform = GetActorTransform();
+	CurrentSimTransform = GetActorTransform();
 	if(IsLocallyControlled())
 	{
 		LocalStatus.SpringArmPitch = SpringArm->GetRelativeRotation().Pitch;
@@ -113,8 +163,9 @@ void ABasePawnPlayer::BeginPlay()
 		LocalStatus.ShooterRotation = GetActorRotation();
 		LocalStatus.BoostCount = MaxBoosts;
 	}
-	else
+	else if(HasAuthority())
 	{
+		//clients keep what was replicated, fields that haven't changed since aren't sent again
 		StatusOnServer.SpringArmPitch = SpringArm->GetRelativeRotation().Pitch;
 		StatusOnServer.SpringArmYaw = SpringArm->GetRelativeRotation().Yaw;
 		StatusOnServer.ShooterLocation = GetActorLocation();
@@ -123,19 +174,77 @@ void ABasePawnPlayer::BeginPlay()
 	}
 }
 
+void ABasePawnPlayer::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	MoveRecorder.End();
+	Super::EndPlay(EndPlayReason);
+}
+
 void ABasePawnPlayer::Tick(const float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 	
-	//current fixed time step of 60 per second
+	//current fixed time step of 60 per second, run every step the accumulator owes
 	AccumulatedDeltaTime += DeltaTime;
-	if(AccumulatedDeltaTime >= FixedTimeStep)
+	if(bReplayPending)
+	{
+		//carry on with a replay that ran out of budget last frame
+		PlayUnacknowledgedMoves();
+	}
+	int32 Substeps = 0;
+	while(AccumulatedDeltaTime >= FixedTimeStep && Substeps < MaxSubstepsPerFrame)
 	{
-		ShooterMovement(FixedTimeStep);
-		InterpAutonomousCSPTransform(FixedTimeStep);
-		MoveClientProxies(FixedTimeStep);
-		DebugMode();
+		PreviousSimTransform = GetActorTransform();
+		{
+			//the step only moves the capsule, its children and overlaps catch up once when the scope closes
+			FScopedMovementUpdate ScopedStepUpdate(Capsule, EScopedUpdate::DeferredUpdates);
+			ShooterMovement(FixedTimeStep);
+			InterpAutonomousCSPTransform(FixedTimeStep);
+			MoveClientProxies(FixedTimeStep);
+		}
+		BasePawnPlayer::NumMovementSteps.fetch_add(1, std::memory_order_relaxed);
+		INC_DWORD_STAT(STAT_GravityMovementSteps);
+		AccumulatedDeltaTime -= FixedTimeStep;
+		Substeps++;
+	}
+	if(Substeps == MaxSubstepsPerFrame)
+	{
+		//drop whatever time is still owed instead of spiraling
+		AccumulatedDeltaTime = FMath::Min(AccumulatedDeltaTime, FixedTimeStep);
+	}
+	if(Substeps > 0 && HitboxHistory.IsValid())
+	{
+		bHitboxFramePending = true;
 	}
+	if(Substeps > 0)
+	{
+		//held movement is re-triggered every frame, keep it for all the substeps of this frame
+		MoveVector = FVector::ZeroVector;
+	}
+	if(GetLocalRole() == ROLE_SimulatedProxy)
+	{
+		//proxies are sampled every frame from their snapshots, they don't need the fixed step blend
+		InterpolateProxyFromSnapshots();
+		PreviousSimTransform = GetActorTransform();
+	}
+	CurrentSimTransform = GetActorTransform();
+	InterpolateRenderTransform(AccumulatedDeltaTime / FixedTimeStep);
+	DebugMode();
+}
+
+void ABasePawnPlayer::InterpolateRenderTransform(const float Alpha)
+{
+	if(Skeleton == nullptr || GetNetMode() == NM_DedicatedServer)
+	{
+		return;
+	}
+	//the actor stays on the newest sim state, only the skeleton (and the camera under it) is drawn between the last two
+	FTransform RenderTransform = CurrentSimTransform;
+	if(FVector::DistSquared(PreviousSimTransform.GetLocation(), CurrentSimTransform.GetLocation()) < FMath::Square(RenderInterpolationSnapDistance))
+	{
+		RenderTransform.Blend(PreviousSimTransform, CurrentSimTransform, FMath::Clamp(Alpha, 0.f, 1.f));
+	}
+	Skeleton->SetRelativeTransform(SkeletonRelativeTransform * RenderTransform * CurrentSimTransform.Inverse());
 }
 
 void ABasePawnPlayer::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
@@ -158,9 +267,15 @@ void ABasePawnPlayer::SetupPlayerInputComponent(UInputComponent* PlayerInputComp
 
 void ABasePawnPlayer::ShooterMovement(const float DeltaTime)
 {
+	GRAVITY_SCOPE_CYCLE_COUNTER(STAT_GravityShooterMovement);
 	if(IsLocallyControlled())
 	{
+		//physics can move the capsule between steps, so always step from where the actor actually is
+		LocalStatus.ShooterLocation = GetActorLocation();
+		LocalStatus.ShooterRotation = GetActorRotation();
+		
 		FShooterMove MoveToSend;
+		BuildLook(MoveToSend);
 		if(!bIsInterpolatingClientStatus)
 		{
 			//build the move to either execute or send to the server and the server is not fixing our position
@@ -169,21 +284,25 @@ void ABasePawnPlayer::ShooterMovement(const float DeltaTime)
 			BuildJump(MoveToSend);
 			BuildMagnetized(MoveToSend);
 			BuildBoost(MoveToSend);
-			if(GetWorld() && GetWorld()->GetGameState()) MoveToSend.GameTime = GetWorld()->GetGameState()->GetServerWorldTimeSeconds();
+			MoveToSend.FloorContact = LocalStatus.ShooterFloorStatus;
+			MoveToSend.ContactFloor = LocalStatus.CurrentFloor;
 			
-			LocalStatus.CurrentVelocity = Movement_Internal(MoveToSend.MovementVector, LocalStatus, DeltaTime);
-			Magnetize_Internal(MoveToSend.bMagnetizedPressed, LocalStatus);
-			Boost_Internal(MoveToSend.BoostDirection, MoveToSend.bBoost, false, LocalStatus);
-			if(LocalStatus.ShooterFloorStatus != EShooterFloorStatus::BaseFloorContact)
+			if(HasAuthority())
+			{
+				//bots and a listen server's own pawn have nobody to agree with, their floor can come from the batch
+				MovementSimulation.SimulateMovement(MoveToSend, LocalStatus, MakeBatchedWorldQuery(), DeltaTime);
+			}
+			else
 			{
-				SetActorTransform(PerformGravity(LocalStatus, DeltaTime));
+				//predicted with the same inline query the server and our replays use
+				MovementSimulation.SimulateMovement(MoveToSend, LocalStatus, MakeWorldQuery(), DeltaTime);
 			}
-			AddActorWorldOffset(Jump_Internal(MoveToSend.bJumped, LocalStatus, DeltaTime));
+			ApplyFloorStatusToComponents(LocalStatus);
 		}
-		SpringArm->SetRelativeRotation(PitchLook_Internal(LocalStatus, DeltaTime));
-		AddActorLocalRotation(AddShooterSpin_Internal(LocalStatus, DeltaTime));
-		AddActorLocalRotation(YawLook_Internal(LocalStatus, DeltaTime));
-		AddActorWorldOffset(LocalStatus.CurrentVelocity);
+		MovementSimulation.SimulateLook(MoveToSend, LocalStatus, DeltaTime);
+		
+		SpringArm->SetRelativeRotation(FRotator(LocalStatus.SpringArmPitch, LocalStatus.SpringArmYaw, 0.f));
+		SetActorTransform(FTransform(LocalStatus.ShooterRotation, LocalStatus.ShooterLocation));
 		
 		LocalStatus.ShooterLocation = GetActorLocation();
 		LocalStatus.ShooterRotation = GetActorRotation();
@@ -195,191 +314,120 @@ void ABasePawnPlayer::ShooterMovement(const float DeltaTime)
 		
 		if(!HasAuthority() && !bIsInterpolatingClientStatus)
 		{
-			UnacknowledgedMoves.Add(MoveToSend);
-			ServerSendMove(MoveToSend);
+			QueueMoveForServer(MoveToSend);
 		}
 		if(HasAuthority())
 		{
 			StatusOnServer = LocalStatus;
+			StatusOnServer.ServerTime = GetServerWorldTime();
 		}
 	}
 }
 
-void ABasePawnPlayer::MovePressed(const FInputActionValue& ActionValue)
+FShooterMovementSettings ABasePawnPlayer::BuildMovementSettings() const
 {
-	MoveVector = ActionValue.Get<FVector>();
+	FShooterMovementSettings Settings;
+	Settings.SphereFloorMovementPercent = SphereFloorMovementPercent;
+	Settings.LevelSphereMovementPercent = LevelSphereMovementPercent;
+	Settings.GroundForwardSpeed = GroundForwardSpeed;
+	Settings.GroundBackwardSpeed = GroundBackwardSpeed;
+	Settings.GroundLateralSpeed = GroundLateralSpeed;
+	Settings.GroundForwardLateralSpeed = GroundForwardLateralSpeed;
+	Settings.StoppingSpeed = StoppingSpeed;
+	Settings.AccelerationSpeed = AccelerationSpeed;
+	Settings.AirSpeed = AirSpeed;
+	Settings.SpringArmPitchSpeed = SpringArmPitchSpeed;
+	Settings.SpringArmPitchMax = SpringArmPitchMax;
+	Settings.SpringArmPitchMin = SpringArmPitchMin;
+	Settings.AirPitchSpeed = AirPitchSpeed;
+	Settings.MaxPitchSpeed = MaxPitchSpeed;
+	Settings.AirRotationSpeed = AirRotationSpeed;
+	Settings.AirRotationMaxSpeed = AirRotationMaxSpeed;
+	Settings.SphereTraceRadius = SphereTraceRadius;
+	Settings.GravityDistanceRadius = GravityDistanceRadius;
+	Settings.SlerpSpeed = SlerpSpeed;
+	Settings.OutRangeGravityStrength = OutRangeGravityStrength;
+	Settings.InRangeGravityStrength = InRangeGravityStrength;
+	Settings.GravityForceCurve = GravityForceCurve;
+	Settings.GravityVelocityReduction = GravityVelocityReduction;
+	Settings.FloorCacheMoveThreshold = FloorCacheMoveThreshold;
+	Settings.FloorCacheMaxAge = FloorCacheMaxAge;
+	Settings.FloorSwitchHysteresis = FloorSwitchHysteresis;
+	Settings.LandingDistanceTolerance = LandingDistanceTolerance;
+	Settings.LandingRotationTolerance = LandingRotationTolerance;
+	Settings.JumpVelocity = JumpVelocity;
+	Settings.BoostLastVelocityReduction = BoostLastVelocityReduction;
+	Settings.NonContactedBoostSpeed = NonContactedBoostSpeed;
+	Settings.ContactedBoostSpeed = ContactedBoostSpeed;
+	Settings.BoostRechargeRate = BoostRechargeRate;
+	Settings.MaxBoosts = MaxBoosts;
+	return Settings;
 }
 
-void ABasePawnPlayer::BuildMovement(FShooterMove& OutMove)
+FShooterWorldQuery ABasePawnPlayer::MakeWorldQuery(const bool bLogQueries) const
 {
-	OutMove.MovementVector = MoveVector;
-	MoveVector = FVector::ZeroVector;
+	return FShooterWorldQuery(GetWorld(), GravityLevelSphere, GravityDistanceRadius, SphereTraceRadius, bLogQueries ? this : nullptr);
 }
 
-FVector ABasePawnPlayer::Movement_Internal(const FVector ActionValue, FShooterStatus& OutStatus, const float DeltaTime) const
+FShooterBatchedWorldQuery ABasePawnPlayer::MakeBatchedWorldQuery() const
 {
-	const FVector InputMovementVector = TotalMovementInput(ActionValue, OutStatus, DeltaTime);
-	return CalculateMovementVelocity(InputMovementVector,OutStatus, DeltaTime);
+	UGravityQuerySubsystem* QuerySubsystem = bUseBatchedGravityQueries ? GetWorld()->GetSubsystem<UGravityQuerySubsystem>() : nullptr;
+	return FShooterBatchedWorldQuery(MakeWorldQuery(), QuerySubsystem, this, GravityLevelSphere, GravityDistanceRadius, SphereTraceRadius);
 }
 
-FVector ABasePawnPlayer::TotalMovementInput(const FVector ActionValue, const FShooterStatus InStatus, const float DeltaTime) const
+void ABasePawnPlayer::ApplyFloorStatusToComponents(const FShooterStatus& InStatus)
 {
-	const FVector ForwardVector = InStatus.ShooterRotation.Quaternion().GetAxisX();
-	const FVector RightVector = InStatus.ShooterRotation.Quaternion().GetAxisY();
-	const FVector UpVector = InStatus.ShooterRotation.Quaternion().GetAxisZ();
-	
-	if(InStatus.ShooterFloorStatus != EShooterFloorStatus::NoFloorContact) //if contacted with a floor
+	//the simulation only changes the status, the actor side of losing a floor happens here
+	if(InStatus.ShooterFloorStatus == EShooterFloorStatus::NoFloorContact)
 	{
-		
-		if(ActionValue.X > 0.f && ActionValue.Y == 0.f)
-		{
-			//if just going forward, go GroundForwardSpeed
-			return ForwardVector * ActionValue.X * GroundForwardSpeed * DeltaTime;
-		}
-		if(ActionValue.X > 0.f && ActionValue.Y != 0.f)
-		{
-			//if going forward and any lateral input, go a constant ForwardLateralSpeed
-			return RightVector * ActionValue.Y * (GroundForwardLateralSpeed/2.f) * DeltaTime + ForwardVector * ActionValue.X * (GroundForwardLateralSpeed/2.f) * DeltaTime;
-		}
-		if(ActionValue.X == 0.f && ActionValue.Y != 0.f)
+		if(Capsule && !Capsule->IsSimulatingPhysics())
 		{
-			//if not going forward and any lateral input, go a constant GroundLateralSpeed
-			return RightVector * ActionValue.Y * GroundLateralSpeed * DeltaTime;
+			Capsule->SetSimulatePhysics(true);
 		}
-		if(ActionValue.X < 0.f)
+		if(FootBox)
 		{
-			//if going backwards at all, go the GroundBackwardSpeed
-			return RightVector * ActionValue.Y * (GroundBackwardSpeed/2.f) * DeltaTime + ForwardVector * ActionValue.X * (GroundBackwardSpeed/2.f) * DeltaTime;
+			FootBox->OnComponentEndOverlap.RemoveDynamic(this, &ABasePawnPlayer::EndFloorCheck);
 		}
-		
-	}
-	else //if not contacted with a floor
-	{
-		return (ForwardVector * ActionValue.X + RightVector * ActionValue.Y + UpVector * ActionValue.Z) * DeltaTime;
 	}
-	return FVector::ZeroVector;
 }
 
-FVector ABasePawnPlayer::CalculateMovementVelocity(const FVector InMovementInput, FShooterStatus& OutStatus, const float DeltaTime) const
+void ABasePawnPlayer::InjectInput(const FVector& InMoveVector, const FVector2D& InLook, const bool bInJump, const bool bInMagnetize, const bool bInBoost)
 {
-	if(OutStatus.ShooterFloorStatus == EShooterFloorStatus::BaseFloorContact && OutStatus.bMagnetized) //if walking on a flat floor and magnetized
+	MoveVector = InMoveVector;
+	PitchValue += InLook.Y;
+	YawValue += InLook.X;
+	bJumpPressed |= bInJump;
+	bMagnetizedPressed |= bInMagnetize;
+	if(bInBoost)
 	{
-		if(InMovementInput.Size() == 0.f)
-		{
-			return FMath::VInterpTo(OutStatus.CurrentVelocity, FVector::ZeroVector, DeltaTime, StoppingSpeed);
-		}
-		return  FMath::VInterpTo(OutStatus.CurrentVelocity, InMovementInput, DeltaTime, AccelerationSpeed);
+		bBoostPressed = true;
+		BoostDirection = InMoveVector;
 	}
-	if(OutStatus.ShooterFloorStatus == EShooterFloorStatus::SphereFloorContact && OutStatus.bMagnetized) //if walking on a sphere and magnetized
-	{
-		if(InMovementInput.Size() == 0.f)
-		{
-			OutStatus.SphereLastVelocity = FMath::VInterpTo(OutStatus.SphereLastVelocity, FVector::ZeroVector, DeltaTime, StoppingSpeed);
-			const FMatrix InputRotation = FRotationMatrix::MakeFromXZ(OutStatus.SphereLastVelocity, OutStatus.ShooterRotation.Quaternion().GetAxisZ());
-			const FVector SphereToActor = OutStatus.ShooterLocation - OutStatus.SphereLocation;
-			const FVector NewPosition = SphereToActor.RotateAngleAxis(OutStatus.SphereLastVelocity.Size(), InputRotation.GetUnitAxis(EAxis::Y));
-			return NewPosition - SphereToActor;
-		}
-		const FVector AdjustedControlInputVector = InMovementInput * SphereFloorMovementPercent;
-		OutStatus.SphereLastVelocity = FMath::VInterpTo(OutStatus.SphereLastVelocity, AdjustedControlInputVector, DeltaTime, AccelerationSpeed);
-		const FMatrix InputRotation = FRotationMatrix::MakeFromXZ(OutStatus.SphereLastVelocity, OutStatus.ShooterRotation.Quaternion().GetAxisZ());
-		const FVector SphereToActor = OutStatus.ShooterLocation - OutStatus.SphereLocation;
-		const FVector NewPosition = SphereToActor.RotateAngleAxis(OutStatus.SphereLastVelocity.Size(), InputRotation.GetUnitAxis(EAxis::Y));
-		return NewPosition - SphereToActor;
-	}
-	if(OutStatus.ShooterFloorStatus == EShooterFloorStatus::SphereLevelContact && OutStatus.bMagnetized) //if walking in a sphere and magnetized OR jumping on level sphere
-	{
-		if(InMovementInput.Size() == 0.f)
-		{
-			OutStatus.SphereLastVelocity = FMath::VInterpTo(OutStatus.SphereLastVelocity, FVector::ZeroVector, DeltaTime, StoppingSpeed);
-			const FMatrix InputRotation = FRotationMatrix::MakeFromXZ(OutStatus.SphereLastVelocity, OutStatus.ShooterRotation.Quaternion().GetAxisZ());
-			const FVector SphereToActor = OutStatus.ShooterLocation - OutStatus.SphereLocation;
-			const FVector NewPosition = SphereToActor.RotateAngleAxis(OutStatus.SphereLastVelocity.Size(), InputRotation.GetUnitAxis(EAxis::Y));
-			return NewPosition - SphereToActor;
-		}
-		const FVector AdjustedControlInputVector = -InMovementInput * LevelSphereMovementPercent;
-		OutStatus.SphereLastVelocity = FMath::VInterpTo(OutStatus.SphereLastVelocity, AdjustedControlInputVector, DeltaTime, AccelerationSpeed);
-		const FMatrix InputRotation = FRotationMatrix::MakeFromXZ(OutStatus.SphereLastVelocity, OutStatus.ShooterRotation.Quaternion().GetAxisZ());
-		const FVector SphereToActor = OutStatus.ShooterLocation - OutStatus.SphereLocation;
-		const FVector NewPosition = SphereToActor.RotateAngleAxis(OutStatus.SphereLastVelocity.Size(), InputRotation.GetUnitAxis(EAxis::Y));
-		return NewPosition - SphereToActor;
-	}
-	return OutStatus.CurrentVelocity + InMovementInput * AirSpeed;
 }
 
-void ABasePawnPlayer::LookActivated(const FInputActionValue& ActionValue)
+void ABasePawnPlayer::MovePressed(const FInputActionValue& ActionValue)
 {
-	PitchValue = ActionValue.Get<FVector2D>().Y;
-	YawValue = ActionValue.Get<FVector2D>().X;
+	MoveVector = ActionValue.Get<FVector>();
 }
 
-FRotator ABasePawnPlayer::PitchLook_Internal(FShooterStatus& OutStatus, float DeltaTime)
+void ABasePawnPlayer::BuildMovement(FShooterMove& OutMove)
 {
-	OutStatus.SpringArmPitch = FMath::Clamp(OutStatus.SpringArmPitch + (PitchValue * DeltaTime * SpringArmPitchSpeed), SpringArmPitchMin, SpringArmPitchMax);
-	if(OutStatus.SpringArmPitch > (SpringArmPitchMax - 1.5f) && OutStatus.ShooterFloorStatus == EShooterFloorStatus::NoFloorContact)
-	{
-		OutStatus.ShooterSpin = EShooterSpin::BackFlip;
-	}
-	else if(OutStatus.SpringArmPitch < (SpringArmPitchMin + 1.5f) && OutStatus.ShooterFloorStatus == EShooterFloorStatus::NoFloorContact)
-	{
-		OutStatus.ShooterSpin = EShooterSpin::FrontFlip;
-	}
-	else
-	{
-		OutStatus.ShooterSpin = EShooterSpin::NoFlip;
-	}
-	PitchValue = 0.f;
-	return FRotator(OutStatus.SpringArmPitch, OutStatus.SpringArmYaw, 0.f);
+	OutMove.MovementVector = MoveVector;
 }
 
-FRotator ABasePawnPlayer::AddShooterSpin_Internal(FShooterStatus InStatus, float DeltaTime)
+void ABasePawnPlayer::LookActivated(const FInputActionValue& ActionValue)
 {
-	//We are not contacted to a floor
-	if(InStatus.ShooterFloorStatus == EShooterFloorStatus::NoFloorContact)
-	{
-		float NewPitchRotation;
-		switch (InStatus.ShooterSpin)
-		{
-		case EShooterSpin::BackFlip:
-			if(PitchValue <= 0.f)
-			{
-				return FRotator(InStatus.LastPitchRotation, 0.f, 0.f);
-			}
-			NewPitchRotation = FMath::Clamp(InStatus.LastPitchRotation + PitchValue * AirPitchSpeed * DeltaTime, -MaxPitchSpeed, MaxPitchSpeed);
-			return FRotator(InStatus.LastPitchRotation = NewPitchRotation, 0.f, 0.f);
-		case EShooterSpin::FrontFlip:
-			if(PitchValue >= 0.f)
-			{
-				return FRotator(InStatus.LastPitchRotation, 0.f, 0.f);
-			}
-			NewPitchRotation = FMath::Clamp(InStatus.LastPitchRotation - PitchValue * -AirPitchSpeed * DeltaTime, -MaxPitchSpeed, MaxPitchSpeed);
-			return FRotator(InStatus.LastPitchRotation = NewPitchRotation, 0.f, 0.f);
-		case EShooterSpin::NoFlip:
-			return FRotator(InStatus.LastPitchRotation, 0.f, 0.f);
-		default:
-			return FRotator(InStatus.LastPitchRotation, 0.f, 0.f);
-		}
-	}
-	return FRotator(LocalStatus.LastPitchRotation, 0.f, 0.f);
+	//frames without a fixed step would otherwise lose their mouse movement
+	PitchValue += ActionValue.Get<FVector2D>().Y;
+	YawValue += ActionValue.Get<FVector2D>().X;
 }
 
-FRotator ABasePawnPlayer::YawLook_Internal(FShooterStatus& OutStatus, float DeltaTime)
+void ABasePawnPlayer::BuildLook(FShooterMove& OutMove)
 {
-	//We are contacted to a floor
-	if(OutStatus.ShooterFloorStatus != EShooterFloorStatus::NoFloorContact)
-	{
-		const float FloorValue = YawValue;
-		YawValue = 0.f;
-		return FRotator(0.f, FloorValue, 0.f);
-	}
-	//We are not contacted to a floor
-	if(YawValue == 0.f)
-	{
-		return FRotator(0.f, OutStatus.LastYawRotation, 0.f);
-	}
-	const float NewYawRotation = FMath::Clamp(OutStatus.LastYawRotation + YawValue * AirRotationSpeed * DeltaTime, -AirRotationMaxSpeed, AirRotationMaxSpeed);
+	OutMove.PitchInput = PitchValue;
+	OutMove.YawInput = YawValue;
+	PitchValue = 0.f;
 	YawValue = 0.f;
-	return FRotator(0.f, OutStatus.LastYawRotation = NewYawRotation, 0.f);
 }
 
 void ABasePawnPlayer::JumpPressed(const FInputActionValue& ActionValue)
@@ -396,20 +444,6 @@ void ABasePawnPlayer::BuildJump(FShooterMove& OutMove)
 	}
 }
 
-FVector ABasePawnPlayer::Jump_Internal(const bool bJumpWasPressed, FShooterStatus& OutStatus, const float DeltaTime)
-{
-	if(bJumpWasPressed)
-	{
-		if(OutStatus.ShooterFloorStatus != EShooterFloorStatus::NoFloorContact && OutStatus.bMagnetized) //if we are in contact with a floor
-		{
-			OutStatus.JumpForce = OutStatus.ShooterRotation.Quaternion().GetAxisZ() * JumpVelocity + OutStatus.CurrentVelocity;
-			OutStatus.CurrentVelocity = FVector::ZeroVector;
-			return OutStatus.JumpForce;
-		}
-	}
-	return OutStatus.JumpForce;
-}
-
 void ABasePawnPlayer::Crouch(const FInputActionValue& ActionValue)
 {
 	//ideas for crouch
@@ -432,18 +466,6 @@ void ABasePawnPlayer::BuildMagnetized(FShooterMove& OutMove)
 	}
 }
 
-void ABasePawnPlayer::Magnetize_Internal(bool bMagnetizedFromMove, FShooterStatus& OutStatus)
-{
-	if(bMagnetizedFromMove)
-	{
-		OutStatus.bMagnetized = !OutStatus.bMagnetized;
-	}
-	if(!OutStatus.bMagnetized)
-	{
-		OutStatus.ShooterFloorStatus = SetFloorStatus(EShooterFloorStatus::NoFloorContact, OutStatus);
-	}
-}
-
 void ABasePawnPlayer::BoostPressed(const FInputActionValue& ActionValue)
 {
 	bBoostPressed = true;
@@ -461,317 +483,195 @@ void ABasePawnPlayer::BuildBoost(FShooterMove& OutMove)
 	}
 }
 
-void ABasePawnPlayer::Boost_Internal(FVector BoostVector, bool bBoostWasPressed, bool bIsPredictiveState, FShooterStatus& OutStatus)
+void ABasePawnPlayer::OnFloorHit(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
 {
-	if(bBoostWasPressed)
+	if(LocalStatus.ShooterFloorStatus == EShooterFloorStatus::NoFloorContact && LocalStatus.bMagnetized)
 	{
-		if(OutStatus.BoostCount > 0)
+		if(FVector::DotProduct(GetActorUpVector(), Hit.ImpactNormal) > 0.8f)
 		{
-			FTransform InActorTransform;
-			InActorTransform.SetLocation(OutStatus.ShooterLocation);
-			InActorTransform.SetRotation(OutStatus.ShooterRotation.Quaternion());
-			OutStatus.BoostCount --;
-			if(OutStatus.ShooterFloorStatus == EShooterFloorStatus::NoFloorContact)
+			if(const ASphereFloorBase* SphereFloor = Cast<ASphereFloorBase>(OtherActor))
 			{
-				const FVector WorldBoostVector = InActorTransform.TransformVectorNoScale(BoostVector);
-				OutStatus.CurrentVelocity = WorldBoostVector * NonContactedBoostSpeed + OutStatus.CurrentVelocity /= BoostLastVelocityReduction;
-				if(bIsPredictiveState)
+				MovementSimulation.ApplyFloorContact(EShooterFloorStatus::SphereFloorContact, OtherActor, LocalStatus);
+				SetActorRotation(FRotationMatrix::MakeFromZX(Hit.ImpactNormal, GetActorForwardVector()).Rotator());
+				SetActorLocation(Hit.ImpactPoint + (GetActorLocation() - SphereFloor->GetActorLocation()) * Capsule->GetScaledCapsuleHalfHeight());
+				Capsule->SetSimulatePhysics(false);
+				if(FootBox)
 				{
-					GetWorldTimerManager().SetTimer(BoostRechargeTimerHandle, this, &ABasePawnPlayer::BoostRechargePredictive, BoostRechargeRate);
+					FootBox->OnComponentEndOverlap.AddDynamic(this, &ABasePawnPlayer::EndFloorCheck);
 				}
-				else
+			}
+			else if(const AGravitySphere* LevelSphere = Cast<AGravitySphere>(OtherActor))
+			{
+				MovementSimulation.ApplyFloorContact(EShooterFloorStatus::SphereLevelContact, OtherActor, LocalStatus);
+				SetActorRotation(FRotationMatrix::MakeFromZX(Hit.ImpactNormal, GetActorForwardVector()).Rotator());
+				Capsule->SetSimulatePhysics(false);
+				if(FootBox)
 				{
-					GetWorldTimerManager().SetTimer(BoostRechargeTimerHandle, this, &ABasePawnPlayer::BoostRechargeConfirmed, BoostRechargeRate);
+					FootBox->OnComponentEndOverlap.AddDynamic(this, &ABasePawnPlayer::EndFloorCheck);
 				}
 			}
-			else
+			else if(const AFloorBase* Floor = Cast<AFloorBase>(OtherActor))
 			{
-				ContactedBoostForce(BoostVector, OutStatus);
-				if(bIsPredictiveState)
+				const float DotProductResult = FVector::DotProduct(Floor->GetActorUpVector(), Hit.ImpactNormal);
+				constexpr float Epsilon = 0.001f;
+				if(FMath::IsNearlyEqual(DotProductResult, 1.f, Epsilon) || FMath::IsNearlyEqual(DotProductResult, -1.f, Epsilon))
 				{
-					GetWorldTimerManager().SetTimer(BoostRechargeTimerHandle, this, &ABasePawnPlayer::BoostRechargePredictive, BoostRechargeRate);
+					MovementSimulation.ApplyFloorContact(EShooterFloorStatus::BaseFloorContact, OtherActor, LocalStatus);
+					SetActorRotation(FRotationMatrix::MakeFromZX(Hit.ImpactNormal, GetActorForwardVector()).Rotator());
+					Capsule->SetSimulatePhysics(false);
+					if(FootBox)
+					{
+						FootBox->OnComponentEndOverlap.AddDynamic(this, &ABasePawnPlayer::EndFloorCheck);
+					}
 				}
 				else
 				{
-					GetWorldTimerManager().SetTimer(BoostRechargeTimerHandle, this, &ABasePawnPlayer::BoostRechargeConfirmed, BoostRechargeRate);
+					MagnetizePressed(1.f);
+					LocalStatus.ShooterFloorStatus = SetFloorStatus(EShooterFloorStatus::NoFloorContact, LocalStatus);
+					LocalStatus.CurrentVelocity += Hit.ImpactNormal * (LocalStatus.CurrentVelocity.Size()/2.f);
 				}
 			}
 		}
+		else
+		{
+			MagnetizePressed(1.f);
+			LocalStatus.ShooterFloorStatus = SetFloorStatus(EShooterFloorStatus::NoFloorContact, LocalStatus);
+			LocalStatus.CurrentVelocity += Hit.ImpactNormal * (LocalStatus.CurrentVelocity.Size()/2.f);
+		}
 	}
 }
 
-void ABasePawnPlayer::ContactedBoostForce(const FVector BoostVector, FShooterStatus& OutStatus) const
+void ABasePawnPlayer::EndFloorCheck(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
 {
-	FTransform InActorTransform;
-	InActorTransform.SetLocation(OutStatus.ShooterLocation);
-	InActorTransform.SetRotation(OutStatus.ShooterRotation.Quaternion());
-	const FVector WorldBoostVector = ContactedBoostSpeed * InActorTransform.TransformVectorNoScale(BoostVector);
-	if(OutStatus.ShooterFloorStatus == EShooterFloorStatus::BaseFloorContact)
-	{
-		OutStatus.CurrentVelocity = WorldBoostVector;
-	}
-	if(OutStatus.ShooterFloorStatus == EShooterFloorStatus::SphereFloorContact)
-	{
-		OutStatus.SphereLastVelocity = WorldBoostVector * SphereFloorMovementPercent;
-	}
-	if(OutStatus.ShooterFloorStatus == EShooterFloorStatus::SphereLevelContact)
+	if(LocalStatus.bMagnetized && OtherActor == LocalStatus.CurrentFloor)
 	{
-		OutStatus.SphereLastVelocity = -WorldBoostVector * LevelSphereMovementPercent;
+		MovementSimulation.Magnetize_Internal(true, LocalStatus);
+		ApplyFloorStatusToComponents(LocalStatus);
 	}
 }
 
-void ABasePawnPlayer::BoostRechargeConfirmed()
+void ABasePawnPlayer::Equip(const FInputActionValue& ActionValue)
 {
-	LocalStatus.BoostCount++;
-	if(LocalStatus.BoostCount < MaxBoosts)
-	{
-		GetWorldTimerManager().SetTimer(BoostRechargeTimerHandle, this, &ABasePawnPlayer::BoostRechargeConfirmed, BoostRechargeRate);
-	}
+	
 }
 
-void ABasePawnPlayer::BoostRechargePredictive()
+void ABasePawnPlayer::FirePressed(const FInputActionValue& ActionValue)
 {
-	CSPStatus.BoostCount++;
-	if(CSPStatus.BoostCount < MaxBoosts)
-	{
-		GetWorldTimerManager().SetTimer(BoostRechargeTimerHandle, this, &ABasePawnPlayer::BoostRechargePredictive, BoostRechargeRate);
-	}
+	InjectFire();
 }
 
-FTransform ABasePawnPlayer::PerformGravity(FShooterStatus& OutStatus, const float DeltaTime) const
+void ABasePawnPlayer::ServerFireProjectile_Implementation(const FGravityProjectileSpawn& Spawn)
 {
-	FTransform NewActorTransform;
-	NewActorTransform.SetLocation(OutStatus.ShooterLocation);
-	NewActorTransform.SetRotation(OutStatus.ShooterRotation.Quaternion());
-	if(OutStatus.bMagnetized && OutStatus.ShooterFloorStatus == EShooterFloorStatus::NoFloorContact)
+	if(Combat && Combat->EquippedWeapon && Combat->EquippedWeapon->ConsumeServerShot())
 	{
-		{
-			FindClosestFloor(NewActorTransform, OutStatus);
-			if(OutStatus.ClosestFloor != nullptr)
-			{
-				NewActorTransform.SetRotation(OrientToGravity(NewActorTransform.Rotator(), OutStatus, DeltaTime).Quaternion());
-				OutStatus.LastPitchRotation = 0.f;
-				NewActorTransform.SetLocation(GravityForce(NewActorTransform.GetLocation(), OutStatus, DeltaTime));
-			}
-		}
-		return NewActorTransform;
+		FGravityProjectileSpawn CheckedSpawn = Spawn;
+		ClampShotOrigin(CheckedSpawn);
+		Combat->EquippedWeapon->LaunchProjectile(CheckedSpawn, true);
+		MulticastFireProjectile(CheckedSpawn);
 	}
-	if(OutStatus.bMagnetized && OutStatus.ShooterFloorStatus == EShooterFloorStatus::SphereFloorContact)
+}
+
+void ABasePawnPlayer::MulticastFireProjectile_Implementation(const FGravityProjectileSpawn& Spawn)
+{
+	//the server launched it already and the shooter launched it when they fired
+	if(HasAuthority() || IsLocallyControlled())
 	{
-		if(OutStatus.ClosestFloor != nullptr)
-		{
-			OutStatus.SphereLocation = OutStatus.ClosestFloor->GetActorLocation();
-		}
-		OutStatus.CurrentGravity = OutStatus.SphereLocation - NewActorTransform.GetLocation();
-		NewActorTransform.SetRotation(OrientToGravity(NewActorTransform.Rotator(), OutStatus, DeltaTime).Quaternion());
-		OutStatus.LastPitchRotation = 0.f;
-		return NewActorTransform;
+		return;
 	}
-	if(OutStatus.bMagnetized && OutStatus.ShooterFloorStatus == EShooterFloorStatus::SphereLevelContact)
+	if(Combat && Combat->EquippedWeapon)
 	{
-		if(OutStatus.ClosestFloor != nullptr)
-		{
-			OutStatus.SphereLocation = OutStatus.ClosestFloor->GetActorLocation();
-		}
-		OutStatus.CurrentGravity = NewActorTransform.GetLocation() - OutStatus.SphereLocation;
-		NewActorTransform.SetRotation(OrientToGravity(NewActorTransform.Rotator(), OutStatus, DeltaTime).Quaternion());
-		OutStatus.LastPitchRotation = 0.f;
-		return NewActorTransform;
+		Combat->EquippedWeapon->LaunchProjectile(Spawn, false);
 	}
-	return NewActorTransform;
 }
 
-void ABasePawnPlayer::FindClosestFloor(FTransform ActorTransform, FShooterStatus& OutStatus) const
+void ABasePawnPlayer::ServerFireHitscan_Implementation(const FGravityProjectileSpawn& Shot, const float FireServerTime)
 {
-	//although feet makes more sense for magnetized boots, head position plays more predictably
-	TArray<AActor*> OutActors;
-	if(UWorld* World = GetWorld())
+	if(Combat && Combat->EquippedWeapon && Combat->EquippedWeapon->ConsumeServerShot())
 	{
-		TArray<FOverlapResult> HitOverlaps;
-		FCollisionQueryParams QueryParams;
-		FCollisionResponseParams ResponseParams;
-		FCollisionShape GravitySphere = FCollisionShape::MakeSphere(GravityDistanceRadius);
-		FCollisionShape TraceShape = FCollisionShape::MakeSphere(SphereTraceRadius);
-		
-		World->OverlapMultiByChannel(HitOverlaps, ActorTransform.GetLocation(), FQuat::Identity, ECC_GameTraceChannel1, GravitySphere, QueryParams, ResponseParams);
-		if(bIsInDebugMode)
-		{
-			DrawDebugSphere(World, ActorTransform.GetLocation(), GravityDistanceRadius, 32.f, FColor::Green);
-		}
-		//use a sphere trace to hit a part of the floor that is closer to the player than the center
-		for(FOverlapResult Floor : HitOverlaps)
-		{
-			AActor* CheckIfSphereLevel = Floor.GetActor();
-			if(World && CheckIfSphereLevel == GravityLevelSphere)
-			{
-				FHitResult FindGravityLevelSphereImpact;
-				World->SweepSingleByChannel(FindGravityLevelSphereImpact, ActorTransform.GetLocation(), ActorTransform.GetLocation() + (ActorTransform.GetLocation() - GravityLevelSphere->GetActorLocation()) * GravityDistanceRadius, FQuat::Identity, ECC_GameTraceChannel1, TraceShape, QueryParams, ResponseParams);
-				if(FindGravityLevelSphereImpact.bBlockingHit && (FindGravityLevelSphereImpact.ImpactPoint - ActorTransform.GetLocation()).Size() < OutStatus.ClosestDistanceToFloor)
-				{
-					if(bIsInDebugMode)
-					{
-						DrawDebugPoint(World, FindGravityLevelSphereImpact.ImpactPoint, 50.f, FColor::Red);
-					}
-					OutStatus.FloorHitResult = FindGravityLevelSphereImpact;
-					OutStatus.ClosestDistanceToFloor = (OutStatus.FloorHitResult.ImpactPoint - ActorTransform.GetLocation()).Size();
-					OutStatus.ClosestFloor = Floor.GetActor();
-					OutStatus.CurrentGravity = OutStatus.FloorHitResult.ImpactPoint - ActorTransform.GetLocation();
-				}
-			}
-			else if(World && Floor.GetActor())
-			{
-				FHitResult FindFloorHitResult;
-				World->SweepSingleByChannel(FindFloorHitResult, ActorTransform.GetLocation(), Floor.GetActor()->GetActorLocation(), FQuat::Identity, ECC_GameTraceChannel1, TraceShape, QueryParams, ResponseParams);
-				if(FindFloorHitResult.bBlockingHit && (FindFloorHitResult.ImpactPoint - ActorTransform.GetLocation()).Size() < OutStatus.ClosestDistanceToFloor)
-				{
-					if(bIsInDebugMode)
-					{
-						DrawDebugPoint(World, FindFloorHitResult.ImpactPoint, 50.f, FColor::Red);
-					}
-					OutStatus.FloorHitResult = FindFloorHitResult;
-					OutStatus.ClosestDistanceToFloor = (OutStatus.FloorHitResult.ImpactPoint - ActorTransform.GetLocation()).Size();
-					OutStatus.ClosestFloor = Floor.GetActor();
-					OutStatus.CurrentGravity = OutStatus.FloorHitResult.ImpactPoint - ActorTransform.GetLocation();
-				}
-			}
-		}
+		FGravityProjectileSpawn CheckedShot = Shot;
+		ClampShotOrigin(CheckedShot);
+		const float Now = GetServerWorldTime();
+		Combat->EquippedWeapon->ConfirmHitscan(CheckedShot, FMath::Clamp(FireServerTime, Now - MaxLagCompensationTime, Now));
 	}
 }
 
-FRotator ABasePawnPlayer::OrientToGravity(const FRotator InActorRotation, const FShooterStatus InStatus, const float DeltaTime) const
-{
-	FMatrix FeetToGravity;
-	//If we are going the same way as gravity, use MakeFromXY to reduce amount of unnecessary pivoting, could probably use even more improvement
-	// if(FVector::DotProduct(LastVelocity, CurrentGravity) >= 1.f)
-	// {
-	// 	FeetToGravity = FRotationMatrix::MakeFromZY(-CurrentGravity, GetActorRightVector());
-	// 	const FQuat NewRotation = FQuat::Slerp(InActorRotator.Quaternion(),FeetToGravity.ToQuat(), DeltaTime * (SlerpSpeed/ClosestDistanceToFloor));
-	//
-	// 	return NewRotation.Rotator();
-	// }
-	//If gravity is any other direction then this MakeFromZX should give us the smoothest rotation
-	FeetToGravity = FRotationMatrix::MakeFromZX(-InStatus.CurrentGravity, InActorRotation.Quaternion().GetAxisX());
-	FQuat NewRotation;
-	if(InStatus.ShooterFloorStatus == EShooterFloorStatus::SphereFloorContact || InStatus.ShooterFloorStatus == EShooterFloorStatus::SphereLevelContact)
-	{
-		NewRotation = FQuat::Slerp(InActorRotation.Quaternion(),FeetToGravity.ToQuat(), 1.f);
-	}
-	else
+void ABasePawnPlayer::ClampShotOrigin(FGravityProjectileSpawn& Shot) const
+{
+	//the muzzle here is a little behind the shooter's own, the tolerance covers that much
+	const FVector MuzzleLocation = Combat && Combat->EquippedWeapon ? Combat->EquippedWeapon->GetMuzzleLocation() : GetActorLocation();
+	const FVector Offset = Shot.Origin - MuzzleLocation;
+	if(Offset.SizeSquared() > FMath::Square(MaxShotOriginError))
 	{
-		NewRotation = FQuat::Slerp(InActorRotation.Quaternion(),FeetToGravity.ToQuat(), DeltaTime * (SlerpSpeed/InStatus.ClosestDistanceToFloor));
+		UE_VLOG_SEGMENT(this, LogGravity, Warning, MuzzleLocation, Shot.Origin, FColor::Red, TEXT("Shot origin off by %.0f"), Offset.Size());
+		Shot.Origin = MuzzleLocation + Offset.GetClampedToMaxSize(MaxShotOriginError);
 	}
-	return NewRotation.Rotator();
 }
 
-FVector ABasePawnPlayer::GravityForce(const FVector InActorLocation, FShooterStatus& OutStatus, const float DeltaTime) const
+void ABasePawnPlayer::CaptureHitboxShapes()
 {
-	OutStatus.ClosestDistanceToFloor = OutStatus.FloorHitResult.Distance + SphereTraceRadius;
-	const float DistancePct = FMath::Abs(150 - 100 * (OutStatus.ClosestDistanceToFloor/GravityDistanceRadius));
-	FVector NewVector;
-	if(OutStatus.FloorHitResult.bBlockingHit && DistancePct == 100.f)
+	const bool bKeepsHistory = HasAuthority() && Skeleton != nullptr;
+	for(int32 Box = 0; Box < ShooterNumHitboxes; Box++)
 	{
-		NewVector = FMath::VInterpConstantTo(InActorLocation, FVector(OutStatus.FloorHitResult.ImpactPoint), DeltaTime, InRangeGravityStrength);
+		UBoxComponent* HitBox = HitBoxes[Box];
+		if(HitBox == nullptr)
+		{
+			continue;
+		}
+		if(bKeepsHistory)
+		{
+			FShooterHitboxShape& Shape = HitboxShapes[Box];
+			Shape.BoneIndex = Skeleton->GetBoneIndex(HitBox->GetAttachSocketName());
+			Shape.BoxToBone = HitBox->GetRelativeTransform();
+			Shape.UnscaledExtent = HitBox->GetUnscaledBoxExtent();
+		}
+		//nothing follows the bones every frame or moves with the actor anymore
+		HitBox->DestroyComponent();
+		HitBoxes[Box] = nullptr;
 	}
-	else if(OutStatus.FloorHitResult.bBlockingHit)
+	if(bKeepsHistory)
 	{
-		NewVector = FMath::VInterpConstantTo(InActorLocation, FVector(OutStatus.FloorHitResult.ImpactPoint), DeltaTime, FMath::Pow(OutRangeGravityStrength * DistancePct, GravityForceCurve));
+		HitboxHistory = MakeUnique<FShooterHitboxHistory>();
+		//a server that never draws the mesh still needs its bones posed
+		Skeleton->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
+		Skeleton->OnBoneTransformsFinalized.AddDynamic(this, &ABasePawnPlayer::OnHitboxBonesFinalized);
 	}
-	OutStatus.CurrentVelocity = FMath::VInterpTo(OutStatus.CurrentVelocity, FVector::ZeroVector, DeltaTime, GravityVelocityReduction);
-	OutStatus.SphereLastVelocity = FVector::ZeroVector;
-	return NewVector;
 }
 
-void ABasePawnPlayer::OnFloorHit(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
+void ABasePawnPlayer::OnHitboxBonesFinalized()
 {
-	if(LocalStatus.ShooterFloorStatus == EShooterFloorStatus::NoFloorContact && LocalStatus.bMagnetized)
+	if(bHitboxFramePending && HitboxHistory.IsValid())
 	{
-		if(FVector::DotProduct(GetActorUpVector(), Hit.ImpactNormal) > 0.8f)
-		{
-			if(const ASphereFloorBase* SphereFloor = Cast<ASphereFloorBase>(OtherActor))
-			{
-				LocalStatus.ShooterFloorStatus = SetFloorStatus(EShooterFloorStatus::SphereFloorContact, LocalStatus);
-				LocalStatus.ShooterSpin = EShooterSpin::NoFlip;
-				LocalStatus.LastPitchRotation = 0.f;
-				LocalStatus.LastYawRotation = 0.f;
-				LocalStatus.CurrentVelocity = FVector::ZeroVector;
-				LocalStatus.SphereLastVelocity = FVector::ZeroVector;
-				LocalStatus.CurrentFloor = OtherActor;
-				SetActorRotation(FRotationMatrix::MakeFromZX(Hit.ImpactNormal, GetActorForwardVector()).Rotator());
-				SetActorLocation(Hit.ImpactPoint + (GetActorLocation() - SphereFloor->GetActorLocation()) * Capsule->GetScaledCapsuleHalfHeight());
-				Capsule->SetSimulatePhysics(false);
-				if(FootBox)
-				{
-					FootBox->OnComponentEndOverlap.AddDynamic(this, &ABasePawnPlayer::EndFloorCheck);
-				}
-			}
-			else if(const AGravitySphere* LevelSphere = Cast<AGravitySphere>(OtherActor))
-			{
-				LocalStatus.ShooterFloorStatus = SetFloorStatus(EShooterFloorStatus::SphereLevelContact, LocalStatus);
-				LocalStatus.ShooterSpin = EShooterSpin::NoFlip;
-				LocalStatus.LastPitchRotation = 0.f;
-				LocalStatus.LastYawRotation = 0.f;
-				LocalStatus.CurrentVelocity = FVector::ZeroVector;
-				LocalStatus.SphereLastVelocity = FVector::ZeroVector;
-				LocalStatus.CurrentFloor = OtherActor;
-				SetActorRotation(FRotationMatrix::MakeFromZX(Hit.ImpactNormal, GetActorForwardVector()).Rotator());
-				Capsule->SetSimulatePhysics(false);
-				if(FootBox)
-				{
-					FootBox->OnComponentEndOverlap.AddDynamic(this, &ABasePawnPlayer::EndFloorCheck);
-				}
-			}
-			else if(const AFloorBase* Floor = Cast<AFloorBase>(OtherActor))
-			{
-				const float DotProductResult = FVector::DotProduct(Floor->GetActorUpVector(), Hit.ImpactNormal);
-				constexpr float Epsilon = 0.001f;
-				if(FMath::IsNearlyEqual(DotProductResult, 1.f, Epsilon) || FMath::IsNearlyEqual(DotProductResult, -1.f, Epsilon))
-				{
-					LocalStatus.ShooterFloorStatus = SetFloorStatus(EShooterFloorStatus::BaseFloorContact, LocalStatus);
-					LocalStatus.ShooterSpin = EShooterSpin::NoFlip;
-					LocalStatus.LastPitchRotation = 0.f;
-					LocalStatus.LastYawRotation = 0.f;
-					LocalStatus.CurrentVelocity = FVector::ZeroVector;
-					LocalStatus.SphereLastVelocity = FVector::ZeroVector;
-					LocalStatus.CurrentFloor = OtherActor;
-					SetActorRotation(FRotationMatrix::MakeFromZX(Hit.ImpactNormal, GetActorForwardVector()).Rotator());
-					Capsule->SetSimulatePhysics(false);
-					if(FootBox)
-					{
-						FootBox->OnComponentEndOverlap.AddDynamic(this, &ABasePawnPlayer::EndFloorCheck);
-					}
-				}
-				else
-				{
-					MagnetizePressed(1.f);
-					LocalStatus.ShooterFloorStatus = SetFloorStatus(EShooterFloorStatus::NoFloorContact, LocalStatus);
-					LocalStatus.CurrentVelocity += Hit.ImpactNormal * (LocalStatus.CurrentVelocity.Size()/2.f);
-				}
-			}
-		}
-		else
-		{
-			MagnetizePressed(1.f);
-			LocalStatus.ShooterFloorStatus = SetFloorStatus(EShooterFloorStatus::NoFloorContact, LocalStatus);
-			LocalStatus.CurrentVelocity += Hit.ImpactNormal * (LocalStatus.CurrentVelocity.Size()/2.f);
-		}
+		bHitboxFramePending = false;
+		RecordHitboxHistory();
 	}
 }
 
-void ABasePawnPlayer::EndFloorCheck(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
+void ABasePawnPlayer::RecordHitboxHistory()
 {
-	if(LocalStatus.bMagnetized && OtherActor == LocalStatus.CurrentFloor)
+	GRAVITY_SCOPE_CYCLE_COUNTER(STAT_GravityRecordHitboxes);
+	FShooterHitboxFrame Frame;
+	Frame.ServerTime = GetServerWorldTime();
+	Frame.BoundsCenter = GetActorLocation();
+	for(int32 Box = 0; Box < ShooterNumHitboxes; Box++)
 	{
-		Magnetize_Internal(true, LocalStatus);
-		Capsule->SetSimulatePhysics(true);
+		const FShooterHitboxShape& Shape = HitboxShapes[Box];
+		const FTransform BoneTransform = Shape.BoneIndex != INDEX_NONE ? Skeleton->GetBoneTransform(Shape.BoneIndex) : Skeleton->GetComponentTransform();
+		const FTransform BoxTransform = Shape.BoxToBone * BoneTransform;
+		FShooterHitbox& Hitbox = Frame.Boxes[Box];
+		Hitbox.Center = BoxTransform.GetLocation();
+		Hitbox.Rotation = BoxTransform.GetRotation();
+		Hitbox.Extent = Shape.UnscaledExtent * BoxTransform.GetScale3D().GetAbs();
+		Frame.BoundsRadius = FMath::Max(Frame.BoundsRadius, static_cast<float>(FVector::Dist(Hitbox.Center, Frame.BoundsCenter) + Hitbox.Extent.Size()));
 	}
+	HitboxHistory->Add(Frame);
 }
 
-void ABasePawnPlayer::Equip(const FInputActionValue& ActionValue)
+bool ABasePawnPlayer::GetRewoundHitboxes(const float ServerTime, FShooterHitboxFrame& OutFrame) const
 {
-	
+	return HitboxHistory.IsValid() && HitboxHistory->Sample(ServerTime, OutFrame);
 }
 
-void ABasePawnPlayer::FirePressed(const FInputActionValue& ActionValue)
+void ABasePawnPlayer::InjectFire()
 {
 	if(Combat && Combat->EquippedWeapon)
 	{
@@ -796,86 +696,232 @@ void ABasePawnPlayer::PassDamageToHealth(AActor* DamagedActor, float Damage, con
 
 EShooterFloorStatus ABasePawnPlayer::SetFloorStatus(const EShooterFloorStatus StatusToChangeTo, FShooterStatus& StatusToReset)
 {
-	if(StatusToChangeTo == EShooterFloorStatus::NoFloorContact)
+	StatusToReset.ShooterFloorStatus = FShooterMovementSimulation::SetFloorStatus(StatusToChangeTo, StatusToReset);
+	ApplyFloorStatusToComponents(StatusToReset);
+	return StatusToChangeTo;
+}
+
+
+void ABasePawnPlayer::QueueMoveForServer(const FShooterMove& NewMove)
+{
+	const bool bCoalesceWithLastMove = bOpenIdleMove &&
+		!UnacknowledgedMoves.IsEmpty() &&
+		UnacknowledgedMoves.Last().CanCoalesceWith(NewMove) &&
+		UnacknowledgedMoves.Last().RepeatCount < IdleMoveSendSteps;
+	if(bCoalesceWithLastMove)
 	{
-		ZeroOutGravity(StatusToReset);
-		Capsule->SetSimulatePhysics(true);
+		//the run is every step replayed as it was queued, nothing in it is overwritten
+		UnacknowledgedMoves.Last().RepeatCount++;
 	}
-	return StatusToChangeTo;
+	else
+	{
+		FShooterMove SequencedMove = NewMove;
+		SequencedMove.Sequence = NextMoveSequence++;
+		UnacknowledgedMoves.Add(SequencedMove);
+		bOpenIdleMove = NewMove.IsIdle();
+	}
+	
+	const FShooterMove& LastMove = UnacknowledgedMoves.Last();
+	if(!LastMove.IsIdle() || LastMove.RepeatCount >= IdleMoveSendSteps)
+	{
+		SendMoveBundle();
+	}
+}
+
+void ABasePawnPlayer::SendMoveBundle()
+{
+	FShooterMoveBundle Bundle;
+	const int32 FirstMoveIndex = FMath::Max(0, UnacknowledgedMoves.Num() - (RedundantMovesPerBundle + 1));
+	Bundle.Moves.Reserve(UnacknowledgedMoves.Num() - FirstMoveIndex);
+	for(int32 MoveIndex = FirstMoveIndex; MoveIndex < UnacknowledgedMoves.Num(); MoveIndex++)
+	{
+		Bundle.Moves.Add(UnacknowledgedMoves[MoveIndex]);
+	}
+	ServerSendMove(Bundle);
+	bOpenIdleMove = false;
 }
 
-void ABasePawnPlayer::ZeroOutGravity(FShooterStatus& StatusToReset)
+void ABasePawnPlayer::ServerSendMove_Implementation(const FShooterMoveBundle& ClientMoves)
 {
-	StatusToReset.ClosestDistanceToFloor = FLT_MAX;
-	StatusToReset.ClosestFloor = nullptr;	
-	const FHitResult NewHitResult;
-	StatusToReset.FloorHitResult = NewHitResult;
-	StatusToReset.CurrentGravity = FVector::ZeroVector;
-	StatusToReset.CurrentFloor = nullptr;
-	if(StatusToReset.JumpForce.Size() > 0.f)
+	GRAVITY_SCOPE_CYCLE_COUNTER(STAT_GravityServerSendMove);
+	const int32 FirstMoveIndex = FMath::Max(0, ClientMoves.Moves.Num() - (RedundantMovesPerBundle + 1));
+	for(int32 MoveIndex = FirstMoveIndex; MoveIndex < ClientMoves.Moves.Num(); MoveIndex++)
 	{
-		StatusToReset.CurrentVelocity = StatusToReset.JumpForce;
-		StatusToReset.JumpForce = FVector::ZeroVector;
+		const FShooterMove& ClientMove = ClientMoves.Moves[MoveIndex];
+		if(!FShooterMoveBuffer::IsSequenceNewer(ClientMove.Sequence, LastProcessedMoveSequence))
+		{
+			//already applied from an earlier bundle
+			continue;
+		}
+		FShooterMove& QueuedMove = QueuedServerMoves.Add_GetRef(ClientMove);
+		QueuedMove.RepeatCount = static_cast<uint8>(FMath::Clamp<int32>(ClientMove.RepeatCount, 1, IdleMoveSendSteps));
+		for(int32 Repeat = 0; Repeat < QueuedMove.RepeatCount; Repeat++)
+		{
+			RecordServerMove(ClientMove);
+		}
+		LastProcessedMoveSequence = ClientMove.Sequence;
 	}
-	if(FootBox)
+	if(QueuedServerMoves.Num() > 0)
 	{
-		FootBox->OnComponentEndOverlap.RemoveDynamic(this, &ABasePawnPlayer::EndFloorCheck);
+		if(UGravityQuerySubsystem* QuerySubsystem = GetWorld()->GetSubsystem<UGravityQuerySubsystem>())
+		{
+			QuerySubsystem->QueueServerMoves(this);
+		}
+		else
+		{
+			StepQueuedServerMoves();
+			FinishQueuedServerMoves();
+		}
 	}
 }
 
+void ABasePawnPlayer::StepQueuedServerMoves()
+{
+	//queried inline exactly like the client's replay of these moves, and never logged since this can be a worker
+	const FShooterWorldQuery WorldQuery = MakeWorldQuery(false);
+	FShooterStatus Status = StatusOnServer;
+	bQueuedServerMovesLeftFloor = false;
+	for(const FShooterMove& ClientMove : QueuedServerMoves)
+	{
+		for(int32 Repeat = 0; Repeat < ClientMove.RepeatCount; Repeat++)
+		{
+			Status = MovementSimulation.StepClientMove(ClientMove, Status, WorldQuery, FixedTimeStep);
+			bQueuedServerMovesLeftFloor |= Status.ShooterFloorStatus == EShooterFloorStatus::NoFloorContact;
+		}
+	}
+	CSPStatus = Status;
+}
 
-void ABasePawnPlayer::ServerSendMove_Implementation(FShooterMove ClientMove)
+void ABasePawnPlayer::FinishQueuedServerMoves()
 {
-	CSPStatus = StatusOnServer;
-	
-	CSPStatus.CurrentVelocity = Movement_Internal(ClientMove.MovementVector, CSPStatus, FixedTimeStep);
-	Magnetize_Internal(ClientMove.bMagnetizedPressed, CSPStatus);
-	CSPStatus.ShooterRotation = ClientMove.ShooterRotationAfterMovement;
-	CSPStatus.SpringArmPitch = ClientMove.SpringArmPitch;
-	CSPStatus.LastPitchRotation = ClientMove.LastPitchRotation;
-	CSPStatus.LastYawRotation = ClientMove.LastYawRotation;
-	CSPStatus.ShooterLocation = StatusOnServer.ShooterLocation + CSPStatus.CurrentVelocity;
-	
+	if(QueuedServerMoves.Num() == 0)
+	{
+		return;
+	}
+	//a step that left its floor turns physics on even if a later one landed again
+	FShooterStatus ComponentStatus = CSPStatus;
+	if(bQueuedServerMovesLeftFloor)
+	{
+		ComponentStatus.ShooterFloorStatus = EShooterFloorStatus::NoFloorContact;
+	}
+	ApplyFloorStatusToComponents(ComponentStatus);
+
 	StatusOnServer = CSPStatus;
-	StatusOnServer.LastMove = ClientMove;
+	StatusOnServer.LastMove = QueuedServerMoves.Last();
+	StatusOnServer.ServerTime = GetServerWorldTime();
 	bSetStatusAfterUpdate = true;
+	QueuedServerMoves.Reset();
+}
+
+void ABasePawnPlayer::RecordServerMove(const FShooterMove& ClientMove)
+{
+	if(!FShooterMoveRecorder::WantsRecording())
+	{
+		MoveRecorder.End();
+		return;
+	}
+	if(!MoveRecorder.IsRecording())
+	{
+		FShooterMoveStreamHeader Header;
+		Header.PawnName = GetName();
+		Header.GravityLevelSphereName = GetNameSafe(GravityLevelSphere);
+		Header.Settings = MovementSimulation.GetSettings();
+		Header.FixedTimeStep = FixedTimeStep;
+		Header.InitialStatus = StatusOnServer;
+		if(!MoveRecorder.Begin(Header))
+		{
+			return;
+		}
+	}
+	MoveRecorder.RecordMove(ClientMove);
 }
 
 void ABasePawnPlayer::OnRep_StatusOnServer()
 {
+	GRAVITY_SCOPE_CYCLE_COUNTER(STAT_GravityOnRepStatusOnServer);
+	UE_VLOG_LOCATION(this, LogGravity, Log, StatusOnServer.ShooterLocation, 25.f, FColor::Blue, TEXT("Server status %u at %.3f"), StatusOnServer.LastMove.Sequence, StatusOnServer.ServerTime);
+	if(!IsLocallyControlled())
+	{
+		AddProxySnapshot(StatusOnServer);
+		return;
+	}
 	CSPStatus = StatusOnServer;
+	//the floor hit isn't replicated, it's rebuilt from the server's floor so the replay doesn't start from ours
+	CSPStatus.FloorHitResult = FHitResult();
+	if(CSPStatus.ClosestFloor)
+	{
+		FShooterFloorQueryResult FloorResult;
+		if(MakeWorldQuery(false).FindFloorSurface(CSPStatus.ShooterLocation, CSPStatus.ClosestFloor, FloorResult))
+		{
+			CSPStatus.FloorHitResult = FloorResult.FloorHitResult;
+		}
+		else if(!CSPStatus.CurrentGravity.IsZero())
+		{
+			//not a registered source, the server's gravity still points at the surface it found
+			FShooterWorldQuery::MakeSurfaceHit(CSPStatus.ShooterLocation, CSPStatus.ShooterLocation + CSPStatus.CurrentGravity, -CSPStatus.CurrentGravity.GetSafeNormal(),
+				MovementSimulation.GetSettings().SphereTraceRadius, CSPStatus.ClosestFloor, Cast<UPrimitiveComponent>(CSPStatus.ClosestFloor->GetRootComponent()), CSPStatus.FloorHitResult);
+		}
+	}
 	ClearAcknowledgedMoves();
+	//a new server status starts the replay over
+	ReplayMoveIndex = 0;
+	ReplayRepeatIndex = 0;
 	PlayUnacknowledgedMoves();
 }
 
 void ABasePawnPlayer::ClearAcknowledgedMoves()
 {
-	TArray<FShooterMove> NewMoves;
-	for(FShooterMove MoveToCheck : UnacknowledgedMoves)
-	{
-		if(StatusOnServer.LastMove.GameTime < MoveToCheck.GameTime)
-		{
-			NewMoves.Add(MoveToCheck);
-		}
-	}
-	UnacknowledgedMoves = NewMoves;
+	UnacknowledgedMoves.Acknowledge(StatusOnServer.LastMove.Sequence);
 }
 
 void ABasePawnPlayer::PlayUnacknowledgedMoves()
 {
+	GRAVITY_SCOPE_CYCLE_COUNTER(STAT_GravityPlayUnacknowledgedMoves);
+	bReplayPending = false;
 	if(!bIsInterpolatingClientStatus)
 	{
-		for(const FShooterMove MoveToPlay: UnacknowledgedMoves)
+		if(ReplayBudgetFrame != GFrameCounter)
 		{
-			CSPStatus.CurrentVelocity = Movement_Internal(MoveToPlay.MovementVector, CSPStatus, FixedTimeStep);
-			CSPStatus.ShooterLocation += CSPStatus.CurrentVelocity;
-			DrawDebugPoint(GetWorld(), CSPStatus.ShooterLocation, 30.f, FColor::Blue);
+			ReplayBudgetFrame = GFrameCounter;
+			ReplayStepsThisFrame = 0;
 		}
+		const double ReplayStartTime = FPlatformTime::Seconds();
+		//replayed floor queries would bury the live ones in the log, only the path is recorded
+		const FShooterWorldQuery WorldQuery = MakeWorldQuery(false);
+		while(ReplayMoveIndex < UnacknowledgedMoves.Num() && !bReplayPending)
+		{
+			const FShooterMove& MoveToPlay = UnacknowledgedMoves[ReplayMoveIndex];
+			for(; ReplayRepeatIndex < MoveToPlay.RepeatCount; ReplayRepeatIndex++)
+			{
+				if(ReplayStepsThisFrame >= MaxReplayStepsPerFrame)
+				{
+					//the rest is replayed next frame, from exactly this step
+					bReplayPending = true;
+					break;
+				}
+				const FVector ReplayStepStart = CSPStatus.ShooterLocation;
+				//same step the server applies the move with
+				CSPStatus = MovementSimulation.StepClientMove(MoveToPlay, CSPStatus, WorldQuery, FixedTimeStep);
+				ReplayStepsThisFrame++;
+				ReplayedMovesThisWindow++;
+				UE_VLOG_SEGMENT(this, LogGravity, Verbose, ReplayStepStart, CSPStatus.ShooterLocation, FColor::Cyan, TEXT(""));
+			}
+			if(!bReplayPending)
+			{
+				ReplayMoveIndex++;
+				ReplayRepeatIndex = 0;
+			}
+		}
+		ReplayTimeThisWindow += FPlatformTime::Seconds() - ReplayStartTime;
+		if(bReplayPending)
+		{
+			//CSPStatus is somewhere in the past, comparing against it would be a false correction
+			UE_VLOG_LOCATION(this, LogGravity, Log, CSPStatus.ShooterLocation, 20.f, FColor::Yellow, TEXT("Replay over budget at move %d of %d"), ReplayMoveIndex, UnacknowledgedMoves.Num());
+			return;
+		}
+		ReplaysThisWindow++;
 		CurrentCSPLocationDelta = (GetActorLocation() - CSPStatus.ShooterLocation).Size();
-	}
-	if(bIsInDebugMode)
-	{
-		DrawDebugPoint(GetWorld(), CSPStatus.ShooterLocation, 20.f, FColor::Green);
+		UE_VLOG_LOCATION(this, LogGravity, Log, CSPStatus.ShooterLocation, 20.f, FColor::Green, TEXT("Replayed %d moves"), UnacknowledgedMoves.Num());
 	}
 }
 
@@ -883,13 +929,27 @@ void ABasePawnPlayer::InterpAutonomousCSPTransform(float DeltaTime)
 {
 	if(!HasAuthority() && IsLocallyControlled())
 	{
+		UpdateCorrectionRate(DeltaTime);
+		UpdateReplayStats(DeltaTime);
+		if(bReplayPending)
+		{
+			//nothing to correct towards until the replay has caught up to the present
+			return;
+		}
 		if(CurrentCSPLocationDelta > ServerClintDeltaTolerance)
 		{
+			if(!bIsInterpolatingClientStatus)
+			{
+				CorrectionsThisWindow++;
+				INC_DWORD_STAT(STAT_GravityCorrections);
+				UE_VLOG_SEGMENT(this, LogGravity, Warning, GetActorLocation(), CSPStatus.ShooterLocation, FColor::Red, TEXT("Correction %.1f"), CurrentCSPLocationDelta);
+			}
 			const FVector CurrentVector = GetActorLocation();
 			const FVector ToServerLocation = FMath::VInterpTo(CurrentVector,  CSPStatus.ShooterLocation, DeltaTime, ServerCorrectionSpeed);
 			CurrentCSPLocationDelta = (GetActorLocation() - CSPStatus.ShooterLocation).Size();
 			SetActorLocation(ToServerLocation);
-			UnacknowledgedMoves.Empty();
+			UnacknowledgedMoves.Reset();
+			bOpenIdleMove = false;
 			bIsInterpolatingClientStatus = true;
 		}
 		else
@@ -903,31 +963,99 @@ void ABasePawnPlayer::InterpAutonomousCSPTransform(float DeltaTime)
 	}
 }
 
+void ABasePawnPlayer::UpdateCorrectionRate(const float DeltaTime)
+{
+	CorrectionWindowTime += DeltaTime;
+	if(CorrectionWindowTime >= 60.f)
+	{
+		CorrectionsPerMinute = CorrectionsThisWindow;
+		CorrectionsThisWindow = 0;
+		CorrectionWindowTime -= 60.f;
+		SET_DWORD_STAT(STAT_GravityCorrectionsPerMinute, CorrectionsPerMinute);
+	}
+}
+
+void ABasePawnPlayer::UpdateReplayStats(const float DeltaTime)
+{
+	ReplayWindowTime += DeltaTime;
+	if(ReplayWindowTime >= 1.f)
+	{
+		ReplayedMovesPerSecond = ReplayedMovesThisWindow;
+		MeanReplayTimeMs = ReplaysThisWindow > 0 ? static_cast<float>(ReplayTimeThisWindow * 1000.0 / ReplaysThisWindow) : 0.f;
+		ReplayedMovesThisWindow = 0;
+		ReplaysThisWindow = 0;
+		ReplayTimeThisWindow = 0.0;
+		ReplayWindowTime -= 1.f;
+		SET_DWORD_STAT(STAT_GravityReplayedMovesPerSecond, ReplayedMovesPerSecond);
+		SET_FLOAT_STAT(STAT_GravityMeanReplayTimeMs, MeanReplayTimeMs);
+	}
+}
+
 void ABasePawnPlayer::MoveClientProxies(float DeltaTime)
 {
-	if(!IsLocallyControlled())
+	//simulated proxies on clients go through their snapshots instead
+	if(!IsLocallyControlled() && HasAuthority())
 	{
+		//worked out first and set once, the capsule is only moved a single time
+		FVector NewLocation;
+		FQuat NewRotation;
 		if(bSetStatusAfterUpdate) //while the current location is far away, InterpTo
 		{
-			const FVector CurrentLocation = GetActorLocation();
-			const FVector NewLocation = StatusOnServer.ShooterLocation;
-			const FVector InterpLocation = FMath::VInterpTo(CurrentLocation, NewLocation, DeltaTime, ProxyCorrectionSpeed);
-			SetActorLocation(InterpLocation);
-			const FRotator CurrentRotation = GetActorRotation();
-			const FRotator NewRotation = StatusOnServer.ShooterRotation;
-			const FRotator InterpRotation = FMath::RInterpTo(CurrentRotation, NewRotation, DeltaTime, ProxyCorrectionSpeed);
-			SetActorRotation(InterpRotation);
+			NewLocation = FMath::VInterpTo(GetActorLocation(), StatusOnServer.ShooterLocation, DeltaTime, ProxyCorrectionSpeed);
+			NewRotation = FMath::RInterpTo(GetActorRotation(), StatusOnServer.ShooterRotation, DeltaTime, ProxyCorrectionSpeed).Quaternion();
 			bSetStatusAfterUpdate = false;
 		}
-		else if(!bSetStatusAfterUpdate)//else keep the actor going its last velocity extrapolate 
+		else //else keep the actor going its last velocity extrapolate 
 		{
-			AddActorWorldOffset(StatusOnServer.CurrentVelocity);
-			AddActorLocalRotation(FRotator(StatusOnServer.LastPitchRotation, StatusOnServer.LastYawRotation, 0.f));
+			NewLocation = GetActorLocation() + StatusOnServer.CurrentVelocity;
+			//a local rotation, on the right the same as AddActorLocalRotation
+			NewRotation = GetActorQuat() * FRotator(StatusOnServer.LastPitchRotation, StatusOnServer.LastYawRotation, 0.f).Quaternion();
 		}
+		SetActorLocationAndRotation(NewLocation, NewRotation);
 		// DrawDebugPoint(GetWorld(), StatusOnServer.ShooterLocation, 20.f, FColor::Blue);
 	}
 }
 
+void ABasePawnPlayer::AddProxySnapshot(const FShooterStatus& InStatus)
+{
+	FShooterSnapshot Snapshot;
+	Snapshot.ServerTime = InStatus.ServerTime;
+	Snapshot.Location = InStatus.ShooterLocation;
+	Snapshot.Rotation = InStatus.ShooterRotation.Quaternion();
+	//the tangent is how far it actually went since the last snapshot, CurrentVelocity leaves out jumps and gravity
+	if(!ProxySnapshots.IsEmpty() && InStatus.ServerTime > ProxySnapshots.Last().ServerTime)
+	{
+		const FShooterSnapshot& Previous = ProxySnapshots.Last();
+		Snapshot.Velocity = (Snapshot.Location - Previous.Location) / (Snapshot.ServerTime - Previous.ServerTime);
+	}
+	else
+	{
+		//CurrentVelocity is a per step offset
+		Snapshot.Velocity = InStatus.CurrentVelocity / FixedTimeStep;
+	}
+	ProxySnapshots.Add(Snapshot);
+}
+
+void ABasePawnPlayer::InterpolateProxyFromSnapshots()
+{
+	FTransform ProxyTransform;
+	if(ProxySnapshots.Sample(GetServerWorldTime() - ProxyInterpolationDelay, ProxyMaxExtrapolationTime, ProxyTransform))
+	{
+		SetActorTransform(ProxyTransform);
+	}
+}
+
+float ABasePawnPlayer::GetServerWorldTime() const
+{
+	const UWorld* World = GetWorld();
+	if(World == nullptr)
+	{
+		return 0.f;
+	}
+	const AGameStateBase* GameState = World->GetGameState();
+	return static_cast<float>(GameState ? GameState->GetServerWorldTimeSeconds() : World->GetTimeSeconds());
+}
+
 float ABasePawnPlayer::GetSpringArmPitch() const
 {
 	if(IsLocallyControlled())
@@ -948,6 +1076,7 @@ bool ABasePawnPlayer::GetIsMagnetized() const
 
 void ABasePawnPlayer::DebugMode() const
 {
+#if GRAVITY_DEBUG_DISPLAY
 	if(bIsInDebugMode && IsLocallyControlled())
 	{
 		DrawDebugLine(GetWorld(), GetActorLocation(), GetActorLocation() + (LocalStatus.CurrentVelocity * 10.f), FColor::Green);
@@ -957,6 +1086,8 @@ void ABasePawnPlayer::DebugMode() const
 			GEngine->AddOnScreenDebugMessage(-1,0.f, FColor::Green, FString::Printf(TEXT("%s"), *GetName()));
 			const FColor CSPDeltaColor = CurrentCSPLocationDelta > ServerClintDeltaTolerance ? FColor::Red : FColor::Green;
 			GEngine->AddOnScreenDebugMessage(-1,0.f, CSPDeltaColor, FString::Printf(TEXT("CurrentCSPLocationDelta: %f"), CurrentCSPLocationDelta));
+			GEngine->AddOnScreenDebugMessage(-1,0.f, FColor::Green, FString::Printf(TEXT("CorrectionsPerMinute: %i (%i this minute)"), CorrectionsPerMinute, CorrectionsThisWindow));
+			GEngine->AddOnScreenDebugMessage(-1,0.f, FColor::Green, FString::Printf(TEXT("ReplayedMovesPerSecond: %i MeanReplayTime: %.3fms"), ReplayedMovesPerSecond, MeanReplayTimeMs));
 			const FColor BoostCountColor = LocalStatus.BoostCount == 0 ? FColor::Red : FColor::Green;
 			GEngine->AddOnScreenDebugMessage(-1,0.f, BoostCountColor, FString::Printf(TEXT("BoostCount: %i"), LocalStatus.BoostCount));
 			const FColor MagnetizeColor = LocalStatus.bMagnetized ? FColor::Green : FColor::Red;
@@ -1021,6 +1152,7 @@ void ABasePawnPlayer::DebugMode() const
 			GEngine->AddOnScreenDebugMessage(-1,0.f, FloorStatusColor, FloorStatusString);
 		}
 	}
+#endif
 }
 
 void ABasePawnPlayer::SwitchDebugMode()
@@ -7,7 +7,14 @@
 #include "EnhancedInputComponent.h"
 #include "GameFramework/SpringArmComponent.h"
 #include "Gravity/Components/ShooterCombatComponent.h"
-#include "Gravity/GravityTypes/ShooterFloorStatus.h"
+#include "Gravity/GravityTypes/GravityProjectileTypes.h"
+#include "Gravity/GravityTypes/ShooterMovementTypes.h"
+#include "Gravity/Movement/ShooterMoveBuffer.h"
+#include "Gravity/Movement/ShooterMoveRecorder.h"
+#include "Gravity/Movement/ShooterMovementSimulation.h"
+#include "Gravity/Movement/ShooterSnapshotBuffer.h"
+#include "Gravity/Movement/ShooterWorldQuery.h"
+#include "Gravity/Weapons/ShooterHitboxHistory.h"
 #include "BasePawnPlayer.generated.h"
 
 class USphereComponent;
@@ -25,88 +32,6 @@ class UInputAction;
 class UInputMappingContext;
 class UShooterCombatComponent;
 
-UENUM()
-enum class EShooterSpin : uint8
-{
-	FrontFlip UMETA(DisplayName = "Spin Forwards"),
-	BackFlip UMETA(DisplayName = "Spin Backwards"),
-	NoFlip UMETA(DisplayName = "Don't Spin"),
-};
-
-USTRUCT()
-struct FShooterMove
-{
-	GENERATED_BODY()
-	
-	UPROPERTY()
-	FVector_NetQuantize MovementVector = FVector::ZeroVector;
-	UPROPERTY()
-	FRotator ShooterRotationAfterMovement;
-	UPROPERTY()
-	float LastPitchRotation;
-	UPROPERTY()
-	float LastYawRotation;
-	UPROPERTY()
-	float SpringArmPitch;
-	UPROPERTY()
-	bool bJumped = false;
-	UPROPERTY()
-	bool bMagnetizedPressed = false;
-	UPROPERTY()
-	bool bBoost = false;
-	UPROPERTY()
-	FVector_NetQuantize BoostDirection = FVector::ZeroVector;
-	UPROPERTY()
-	float GameTime;
-};
-
-USTRUCT()
-struct FShooterStatus
-{
-	GENERATED_BODY()
-
-	UPROPERTY()
-	FVector_NetQuantize ShooterLocation;
-	UPROPERTY()
-	FRotator ShooterRotation;
-	UPROPERTY()
-	float SpringArmPitch;
-	UPROPERTY()
-	float SpringArmYaw;
-	UPROPERTY()
-	float LastPitchRotation = 0.f;
-	UPROPERTY()
-	float LastYawRotation = 0.f;
-	UPROPERTY()
-	bool bMagnetized = false;
-	UPROPERTY()
-	int8 BoostCount;
-	UPROPERTY()
-	FVector_NetQuantize CurrentVelocity = FVector::ZeroVector;
-	UPROPERTY()
-	FVector_NetQuantize JumpForce;
-	UPROPERTY()
-	FVector_NetQuantize SphereLastVelocity = FVector::ZeroVector;
-	UPROPERTY()
-    FShooterMove LastMove;
-	UPROPERTY()
-	EShooterFloorStatus ShooterFloorStatus;
-	UPROPERTY()
-	EShooterSpin ShooterSpin = EShooterSpin::NoFlip;
-	UPROPERTY()
-	float ClosestDistanceToFloor = FLT_MAX;
-	UPROPERTY()
-	AActor* ClosestFloor = nullptr;
-	UPROPERTY()
-	AActor* CurrentFloor = nullptr;
-	UPROPERTY()
-	FHitResult FloorHitResult;
-	UPROPERTY()
-	FVector_NetQuantize CurrentGravity;
-	UPROPERTY()
-	FVector_NetQuantize SphereLocation;
-};
-
 UCLASS()
 class GRAVITY_API ABasePawnPlayer : public APawn
 {
@@ -121,11 +46,33 @@ public:
 	void DebugMode() const;
 	UFUNCTION(Exec)
 	void SwitchDebugMode();
-	bool bIsInDebugMode = true;
-	;
+	bool bIsInDebugMode = false;
+
+	//bots and automation tests press the same inputs the input actions do, picked up by the next fixed step
+	void InjectInput(const FVector& InMoveVector, const FVector2D& InLook, bool bInJump = false, bool bInMagnetize = false, bool bInBoost = false);
+	void InjectFire();
+	//every pawn's fixed steps and the transform updates of their components since startup, for the perf tests
+	static uint32 GetNumMovementSteps();
+	static uint32 GetNumComponentTransformUpdates();
+	//server only, Step only touches the statuses and can run on any thread, Finish applies the result on the game thread
+	void StepQueuedServerMoves();
+	void FinishQueuedServerMoves();
+
+	//projectile shots travel as their spawn only, each machine flies its own copy
+	//a lost shot would be a shot the shooter saw and nobody else did, the other copies are only for show
+	UFUNCTION(Server, Reliable)
+	void ServerFireProjectile(const FGravityProjectileSpawn& Spawn);
+	UFUNCTION(NetMulticast, Unreliable)
+	void MulticastFireProjectile(const FGravityProjectileSpawn& Spawn);
+	//hitscan shots carry the server time the shooter saw everyone else at
+	UFUNCTION(Server, Reliable)
+	void ServerFireHitscan(const FGravityProjectileSpawn& Shot, float FireServerTime);
+	//the hit boxes as they were at ServerTime, only the server keeps a history
+	bool GetRewoundHitboxes(float ServerTime, FShooterHitboxFrame& OutFrame) const;
 	
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	
 	//Hit Boxes
 	UPROPERTY(EditAnywhere)
@@ -158,6 +105,8 @@ protected:
 	UBoxComponent* RightHand;
 	UPROPERTY(EditAnywhere)
 	UBoxComponent* LeftHand;
+	//all of the above, in the order their history frames are stored, only until BeginPlay reads their shapes
+	TStaticArray<UBoxComponent*, ShooterNumHitboxes> HitBoxes;
 	
 	//Components
 	UPROPERTY(EditAnywhere)
@@ -217,12 +166,19 @@ protected:
 	float KnockBackImpulse = 1.75f;
 
 private:
+	void CountTransformUpdate(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport);
+
 	//everything involved with network smoothing
 	void InterpAutonomousCSPTransform(float DeltaTime);
 	bool bIsInterpolatingClientStatus = false;
 	bool bIsExtrapolating = false;
 	
 	float CurrentCSPLocationDelta = 0.f;
+	//how often the server had to pull us back, counted over whole minutes
+	void UpdateCorrectionRate(float DeltaTime);
+	float CorrectionWindowTime = 0.f;
+	int32 CorrectionsThisWindow = 0;
+	int32 CorrectionsPerMinute = 0;
 	UPROPERTY(EditAnywhere, Category=Network)
 	float ServerClintDeltaTolerance = 200.f;
 	UPROPERTY(EditAnywhere, Category=Network)
@@ -234,11 +190,61 @@ private:
 	UPROPERTY(EditAnywhere, Category=Network)
 	float ProxyCorrectionSpeed = 4.f;
 
+	//simulated proxies are drawn this far behind the server, so a late packet still lands ahead of the render time
+	void InterpolateProxyFromSnapshots();
+	void AddProxySnapshot(const FShooterStatus& InStatus);
+	FShooterSnapshotBuffer ProxySnapshots;
+	UPROPERTY(EditAnywhere, Category=Network)
+	float ProxyInterpolationDelay = 0.1f;
+	UPROPERTY(EditAnywhere, Category=Network)
+	float ProxyMaxExtrapolationTime = 0.25f;
+
+	//a shot's origin is the client's word, it's pulled back to within this far of our own muzzle
+	void ClampShotOrigin(FGravityProjectileSpawn& Shot) const;
+	UPROPERTY(EditAnywhere, Category=Network)
+	float MaxShotOriginError = 200.f;
+
+	//everything involved with lag compensated hitscan
+	//the hit box components are authoring only, the server rebuilds the boxes from bone transforms and nobody else has them
+	void CaptureHitboxShapes();
+	//a frame that stepped is recorded once the animation has finalized its bones, not from Tick before they're posed
+	UFUNCTION()
+	void OnHitboxBonesFinalized();
+	void RecordHitboxHistory();
+	bool bHitboxFramePending = false;
+	TStaticArray<FShooterHitboxShape, ShooterNumHitboxes> HitboxShapes;
+	TUniquePtr<FShooterHitboxHistory> HitboxHistory;
+	//shots claiming to be older than this are checked at this age instead
+	UPROPERTY(EditAnywhere, Category=Network)
+	float MaxLagCompensationTime = 0.3f;
+	/**
+	 * @end 
+	 */
+
 	UFUNCTION(Server, Unreliable)
-	void ServerSendMove(FShooterMove ClientMove);
+	void ServerSendMove(const FShooterMoveBundle& ClientMoves);
+	//moves from this frame's bundles, stepped by UGravityQuerySubsystem with every other pawn's
+	TArray<FShooterMove> QueuedServerMoves;
+	bool bQueuedServerMovesLeftFloor = false;
+	//every applied move is written out while Gravity.RecordMoves is on, for Gravity.PlayMoves to step again later
+	void RecordServerMove(const FShooterMove& ClientMove);
+	FShooterMoveRecorder MoveRecorder;
 	bool bSetStatusAfterUpdate = false;
-	
-	TArray<FShooterMove> UnacknowledgedMoves;
+	uint16 LastProcessedMoveSequence = 0;
+	
+	FShooterMoveBuffer UnacknowledgedMoves;
+	void QueueMoveForServer(const FShooterMove& NewMove);
+	void SendMoveBundle();
+	//the last unacknowledged move is an idle run that hasn't been sent yet and can still grow
+	bool bOpenIdleMove = false;
+	//0 is what StatusOnServer starts with, so the first real move is 1
+	uint16 NextMoveSequence = 1;
+	//older unacknowledged moves resent with every bundle so a lost packet doesn't lose a press
+	UPROPERTY(EditAnywhere, Category=Network)
+	int32 RedundantMovesPerBundle = 3;
+	//idle players only send a bundle every this many steps
+	UPROPERTY(EditAnywhere, Category=Network)
+	int32 IdleMoveSendSteps = 6;
 	UPROPERTY(ReplicatedUsing = OnRep_StatusOnServer)
 	FShooterStatus StatusOnServer;
 	FShooterStatus LocalStatus;
@@ -250,6 +256,23 @@ private:
 	void ClearAcknowledgedMoves();
 	
 	void PlayUnacknowledgedMoves();
+	//a long stall can leave hundreds of pending steps, past this many per frame the rest is replayed over the next frames
+	UPROPERTY(EditAnywhere, Category=Network)
+	int32 MaxReplayStepsPerFrame = 120;
+	//where a replay that ran out of budget picks up again, CSPStatus is only corrected against once it's done
+	bool bReplayPending = false;
+	int32 ReplayMoveIndex = 0;
+	int32 ReplayRepeatIndex = 0;
+	uint64 ReplayBudgetFrame = 0;
+	int32 ReplayStepsThisFrame = 0;
+	//replay cost, counted over whole seconds
+	void UpdateReplayStats(float DeltaTime);
+	float ReplayWindowTime = 0.f;
+	int32 ReplayedMovesThisWindow = 0;
+	int32 ReplaysThisWindow = 0;
+	double ReplayTimeThisWindow = 0.0;
+	int32 ReplayedMovesPerSecond = 0;
+	float MeanReplayTimeMs = 0.f;
 	
 	/**
 	 * @end 
@@ -258,11 +281,37 @@ private:
 	//Input Functions
 	const float FixedTimeStep = 1.f/60.f;
 	float AccumulatedDeltaTime = 0.f;
+	//caps the catch up after a hitch so a slow frame can't make the next one slower
+	UPROPERTY(EditAnywhere, Category=Movement)
+	int32 MaxSubstepsPerFrame = 4;
 	void ShooterMovement(float DeltaTime);
 	/**
 	 * @end 
 	 */
 
+	//everything involved with smoothing the visible transform between fixed steps
+	void InterpolateRenderTransform(float Alpha);
+	FTransform SkeletonRelativeTransform;
+	FTransform PreviousSimTransform;
+	FTransform CurrentSimTransform;
+	UPROPERTY(EditAnywhere, Category=Movement)
+	float RenderInterpolationSnapDistance = 500.f;
+	/**
+	 * @end 
+	 */
+
+	//everything involved with stepping the movement simulation
+	FShooterMovementSimulation MovementSimulation;
+	FShooterMovementSettings BuildMovementSettings() const;
+	FShooterWorldQuery MakeWorldQuery(bool bLogQueries = true) const;
+	//only pawns the server controls itself read the closest floor from the end of frame batch, client prediction, server steps and replays query inline
+	FShooterBatchedWorldQuery MakeBatchedWorldQuery() const;
+	UPROPERTY(EditAnywhere, Category = Gravity)
+	bool bUseBatchedGravityQueries = true;
+	void ApplyFloorStatusToComponents(const FShooterStatus& InStatus);
+	/**
+	 * @end 
+	 */
 
 	//everything involved with pressing forward, left, right, backward
 	void MovePressed(const FInputActionValue& ActionValue);
@@ -270,11 +319,6 @@ private:
 	void BuildMovement(FShooterMove& OutMove);
 	FVector MoveVector;
 	
-	FVector Movement_Internal(const FVector ActionValue, FShooterStatus& OutStatus, float DeltaTime) const;
-	
-	FVector TotalMovementInput(const FVector ActionValue, FShooterStatus InStatus, float DeltaTime) const;
-	
-	FVector CalculateMovementVelocity(FVector InMovementInput, FShooterStatus& OutStatus, float DeltaTime) const;
 	UPROPERTY(EditAnywhere, Category=Movement)
 	float SphereFloorMovementPercent = 0.025f;
 	UPROPERTY(EditAnywhere, Category=Movement)
@@ -300,32 +344,24 @@ private:
 
 	//everything involved with mouse look rotation
 	void LookActivated(const FInputActionValue& ActionValue);
+	
+	void BuildLook(FShooterMove& OutMove);
 	float PitchValue = 0.f;
 	float YawValue = 0.f;
 	
 	UPROPERTY(Replicated)
 	float SpringArmClientPitch;
 	
-	FRotator PitchLook_Internal(FShooterStatus& OutStatus, float DeltaTime);
 	UPROPERTY(EditAnywhere, Category = MouseMovement)
 	float SpringArmPitchSpeed = 10.f;
 	UPROPERTY(EditAnywhere, Category = MouseMovement)
 	float SpringArmPitchMax = 70.f;
 	UPROPERTY(EditAnywhere, Category = MouseMovement)
 	float SpringArmPitchMin = -75.f;
-	UPROPERTY()
-	EShooterSpin ShooterSpin = EShooterSpin::NoFlip;
-	
-	FRotator AddShooterSpin_Internal(FShooterStatus InStatus, float DeltaTime);
-	UPROPERTY()
-	float LastPitchRotation = 0.f;
 	UPROPERTY(EditAnywhere, Category=MouseMovement)
 	float AirPitchSpeed = 2.f;
 	UPROPERTY(EditAnywhere, Category = MouseMovement)
 	float MaxPitchSpeed = 5.f;
-	
-	FRotator YawLook_Internal(FShooterStatus& OutStatus, float DeltaTime);
-	float LastYawRotation = 0.f;
 	UPROPERTY(EditAnywhere, Category=MouseMovement)
 	float AirRotationSpeed = 0.25f;
 	UPROPERTY(EditAnywhere, Category=MouseMovement)
@@ -337,21 +373,14 @@ private:
 
 
 	//everything involved with gravity
-	FTransform PerformGravity(FShooterStatus& OutStatus, float DeltaTime) const;
-	
-	void FindClosestFloor(FTransform ActorTransform, FShooterStatus& OutStatus) const;
 	UPROPERTY(EditAnywhere, Category = Gravity)
 	float SphereTraceRadius = 750.f;
 	UPROPERTY(EditAnywhere, Category = Gravity)
 	float GravityDistanceRadius = 2500.f;
 	UPROPERTY(EditAnywhere, Category = Gravity)
 	float ImpactEdgeAdjustment = 5.f;
-	
-	FRotator OrientToGravity(FRotator InActorRotation, FShooterStatus InStatus, float DeltaTime) const;
 	UPROPERTY(EditAnywhere, Category = Gravity)
 	float SlerpSpeed = 1000.f;
-	
-	FVector GravityForce(FVector InActorLocation, FShooterStatus& OutStatus, float DeltaTime) const;
 	UPROPERTY(EditAnywhere, Category = Gravity)
 	float OutRangeGravityStrength = 0.3f;
 	UPROPERTY(EditAnywhere, Category = Gravity)
@@ -360,6 +389,16 @@ private:
 	float GravityForceCurve = 2.f;
 	UPROPERTY(EditAnywhere, Category = Gravity)
 	float GravityVelocityReduction = 1.15f;
+	UPROPERTY(EditAnywhere, Category = Gravity)
+	float FloorCacheMoveThreshold = 50.f;
+	UPROPERTY(EditAnywhere, Category = Gravity)
+	float FloorCacheMaxAge = 0.25f;
+	UPROPERTY(EditAnywhere, Category = Gravity)
+	float FloorSwitchHysteresis = 25.f;
+	UPROPERTY(EditAnywhere, Category = Gravity)
+	float LandingDistanceTolerance = 300.f;
+	UPROPERTY(EditAnywhere, Category = Gravity)
+	float LandingRotationTolerance = 30.f;
 	/**
 	 * @end 
 	 */
@@ -370,7 +409,6 @@ private:
 	void BuildJump(FShooterMove& OutMove);
 	bool bJumpPressed = false;
 	
-	FVector Jump_Internal(bool bJumpWasPressed, FShooterStatus& OutStatus, float DeltaTime);
 	UPROPERTY(EditAnywhere, Category=Movement)
 	float JumpVelocity = 10.f;
 	UPROPERTY(EditAnywhere, Category=Movement)
@@ -383,7 +421,6 @@ private:
 	void BuildMagnetized(FShooterMove& OutMove);
 	void MagnetizePressed(const FInputActionValue& ActionValue);
 	bool bMagnetizedPressed = false;
-	void Magnetize_Internal(bool bMagnetizedFromMove, FShooterStatus& OutStatus);
 	/**
 	 * @end
 	 */
@@ -395,11 +432,8 @@ private:
 	FVector BoostDirection;
 	bool bBoostPressed = false;
 	
-	void Boost_Internal(FVector BoostVector, bool bBoostWasPressed, bool bIsPredictiveState, FShooterStatus& OutStatus);
 	UPROPERTY(EditAnywhere, Category=Boost)
 	float BoostLastVelocityReduction = 1.15f;
-	
-	void ContactedBoostForce(const FVector BoostVector, FShooterStatus& OutStatus) const;
 	UPROPERTY(EditAnywhere, Category=Boost)
 	float NonContactedBoostSpeed = 25.f;
 	UPROPERTY(EditAnywhere, Category=Boost)
@@ -410,18 +444,12 @@ private:
 	float BoostRechargeRate = 5.f;
 	UPROPERTY(EditAnywhere, Category = Boost)
 	int8 MaxBoosts = 2;
-
-	void BoostRechargeConfirmed();
-	void BoostRechargePredictive();
-	FTimerHandle BoostRechargeTimerHandle;
 	/**
 	 * @end 
 	 */
 	
 	UFUNCTION()
 	void PassDamageToHealth(AActor* DamagedActor, float Damage, const UDamageType* DamageType, AController* InstigatedBy, AActor* DamageCauser);
-	
-	void ZeroOutGravity(FShooterStatus& StatusToReset);
 
 	UPROPERTY()
 	AActor* GravityLevelSphere = nullptr;
@@ -432,11 +460,18 @@ public:
 	FORCEINLINE EShooterFloorStatus GetFloorStatus() const {return LocalStatus.ShooterFloorStatus;}
 	EShooterFloorStatus SetFloorStatus(EShooterFloorStatus StatusToChangeTo, FShooterStatus& StatusToReset);
 	float GetSpringArmPitch() const;
+	FORCEINLINE int32 GetCorrectionsPerMinute() const { return CorrectionsPerMinute; }
+	FORCEINLINE int32 GetReplayedMovesPerSecond() const { return ReplayedMovesPerSecond; }
+	FORCEINLINE float GetMeanReplayTimeMs() const { return MeanReplayTimeMs; }
 	bool GetIsMagnetized() const;
 	FORCEINLINE USkeletalMeshComponent* GetMesh() const { return Skeleton; }
 	FVector GetHitTarget();
 	FORCEINLINE UShooterCombatComponent* GetCombatComponent() const { return Combat; }
 	FORCEINLINE UShooterHealthComponent* GetHealthComponent() const { return Health; }
 	FORCEINLINE void SetLevelSphere(AActor* SphereToSet) { GravityLevelSphere = SphereToSet;}
+	FORCEINLINE AActor* GetLevelSphere() const { return GravityLevelSphere; }
+	float GetServerWorldTime() const;
+	//the server time simulated proxies are being drawn at on this machine
+	FORCEINLINE float GetProxyRenderTime() const { return GetServerWorldTime() - ProxyInterpolationDelay; }
 };
 
@@ -0,0 +1,149 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterBotComponent.h"
+
+#include "GameFramework/Controller.h"
+#include "Misc/CommandLine.h"
+#include "Gravity/Characters/BasePawnPlayer.h"
+#include "Gravity/Subsystems/GravitySourceSubsystem.h"
+
+
+UShooterBotComponent::UShooterBotComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	//pressed before the pawn's fixed steps run this frame
+	PrimaryComponentTick.TickGroup = TG_PrePhysics;
+}
+
+bool UShooterBotComponent::IsBotClient()
+{
+	return FParse::Param(FCommandLine::Get(), TEXT("GravityBot"));
+}
+
+void UShooterBotComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	Random.Initialize(GetTypeHash(GetOwner()->GetName()) ^ static_cast<uint32>(FPlatformTime::Cycles()));
+	FireTimeRemaining = Random.FRandRange(FireInterval.X, FireInterval.Y);
+}
+
+void UShooterBotComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	const AController* Controller = Cast<AController>(GetOwner());
+	ABasePawnPlayer* Shooter = Controller ? Cast<ABasePawnPlayer>(Controller->GetPawn()) : nullptr;
+	if(Shooter == nullptr)
+	{
+		return;
+	}
+	ActivityTimeRemaining -= DeltaTime;
+	if(ActivityTimeRemaining <= 0.f)
+	{
+		StartActivity(Shooter);
+	}
+
+	LookWander = FMath::Clamp(LookWander + Random.FRandRange(-0.2f, 0.2f), -1.f, 1.f);
+	FVector MoveVector = WalkDirection;
+	FVector2D Look(LookWander * 0.5f, 0.f);
+	bool bJump = false;
+	bool bMagnetize = false;
+	bool bBoost = false;
+	switch(Activity)
+	{
+	case EShooterBotActivity::Walk:
+		break;
+	case EShooterBotActivity::Magnetize:
+		bMagnetize = bActivityPressPending;
+		bActivityPressPending = false;
+		break;
+	case EShooterBotActivity::Boost:
+		bBoost = bActivityPressPending;
+		bActivityPressPending = false;
+		break;
+	case EShooterBotActivity::SphereHop:
+		if(const AActor* Target = HopTarget.Get())
+		{
+			MoveVector = FVector::ZeroVector;
+			Look = SteerToward(Shooter, Target->GetActorLocation());
+			const FVector ToTarget = (Target->GetActorLocation() - Shooter->GetActorLocation()).GetSafeNormal();
+			const bool bFacingTarget = FVector::DotProduct(Shooter->GetActorForwardVector(), ToTarget) >= FMath::Cos(FMath::DegreesToRadians(HopFacingTolerance));
+			if(HopTimeSinceJump < 0.f && bFacingTarget)
+			{
+				bJump = true;
+				HopTimeSinceJump = 0.f;
+			}
+			else if(HopTimeSinceJump >= 0.f)
+			{
+				HopTimeSinceJump += DeltaTime;
+				if(bActivityPressPending && HopTimeSinceJump >= HopBoostDelay)
+				{
+					//boost along the jump to carry across the gap
+					MoveVector = FVector::ForwardVector;
+					bBoost = true;
+					bActivityPressPending = false;
+				}
+			}
+		}
+		break;
+	}
+	Shooter->InjectInput(MoveVector, Look, bJump, bMagnetize, bBoost);
+
+	FireTimeRemaining -= DeltaTime;
+	if(FireTimeRemaining <= 0.f)
+	{
+		Shooter->InjectFire();
+		FireTimeRemaining = Random.FRandRange(FireInterval.X, FireInterval.Y);
+	}
+}
+
+void UShooterBotComponent::StartActivity(ABasePawnPlayer* Shooter)
+{
+	ActivityTimeRemaining = Random.FRandRange(ActivityDuration.X, ActivityDuration.Y);
+	const float Roll = Random.FRand();
+	Activity = Roll < 0.5f ? EShooterBotActivity::Walk : Roll < 0.65f ? EShooterBotActivity::Magnetize : Roll < 0.8f ? EShooterBotActivity::Boost : EShooterBotActivity::SphereHop;
+	bActivityPressPending = true;
+	HopTimeSinceJump = -1.f;
+	HopTarget = nullptr;
+
+	const FVector2D Direction = FVector2D(Random.FRandRange(-1.f, 1.f), Random.FRandRange(-1.f, 1.f)).GetSafeNormal();
+	WalkDirection = FVector(Direction.X, Direction.Y, 0.f);
+	if(WalkDirection.IsNearlyZero())
+	{
+		WalkDirection = FVector::ForwardVector;
+	}
+
+	if(Activity == EShooterBotActivity::SphereHop)
+	{
+		//any registered floor other than the level sphere, picked at random
+		const UGravitySourceSubsystem* GravitySources = GetWorld()->GetSubsystem<UGravitySourceSubsystem>();
+		const int32 NumSources = GravitySources ? GravitySources->Num() : 0;
+		if(NumSources > 1)
+		{
+			const AActor* LevelSphere = Shooter->GetLevelSphere();
+			for(int32 Attempt = 0; Attempt < 4 && !HopTarget.IsValid(); Attempt++)
+			{
+				AActor* Candidate = GravitySources->GetSource(Random.RandHelper(NumSources)).Actor.Get();
+				if(Candidate && Candidate != LevelSphere)
+				{
+					HopTarget = Candidate;
+				}
+			}
+		}
+		if(!HopTarget.IsValid())
+		{
+			Activity = EShooterBotActivity::Walk;
+		}
+	}
+}
+
+FVector2D UShooterBotComponent::SteerToward(const ABasePawnPlayer* Shooter, const FVector& TargetLocation) const
+{
+	const FVector ToTarget = (TargetLocation - Shooter->GetActorLocation()).GetSafeNormal();
+	//the same axes the mouse turns the pawn around
+	const float Yaw = FVector::DotProduct(Shooter->GetActorRightVector(), ToTarget);
+	const float Pitch = FVector::DotProduct(Shooter->GetActorUpVector(), ToTarget);
+	return FVector2D(FMath::Clamp(Yaw * 2.f, -1.f, 1.f), FMath::Clamp(Pitch * 2.f, -1.f, 1.f));
+}
@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "ShooterBotComponent.generated.h"
+
+class ABasePawnPlayer;
+
+UENUM()
+enum class EShooterBotActivity : uint8
+{
+	Walk,
+	Magnetize,
+	Boost,
+	SphereHop,
+};
+
+/**
+ * Sits on a controller and presses inputs on its pawn like a player would, walking, magnetizing, boosting,
+ * hopping to other floors and firing. The pawn builds its moves from these the same as from real input,
+ * so a bot on a client sends the server an ordinary move stream.
+ */
+UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
+class GRAVITY_API UShooterBotComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UShooterBotComponent();
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	//-GravityBot on a client's command line hands its own pawn to a bot
+	static bool IsBotClient();
+
+protected:
+	virtual void BeginPlay() override;
+
+	UPROPERTY(EditAnywhere, Category=Bot)
+	FVector2D ActivityDuration = FVector2D(1.f, 4.f);
+	UPROPERTY(EditAnywhere, Category=Bot)
+	FVector2D FireInterval = FVector2D(0.5f, 2.f);
+	//facing within this many degrees of the floor it's hopping to is close enough to jump
+	UPROPERTY(EditAnywhere, Category=Bot)
+	float HopFacingTolerance = 15.f;
+	UPROPERTY(EditAnywhere, Category=Bot)
+	float HopBoostDelay = 0.3f;
+
+private:
+	void StartActivity(ABasePawnPlayer* Shooter);
+	FVector2D SteerToward(const ABasePawnPlayer* Shooter, const FVector& TargetLocation) const;
+
+	FRandomStream Random;
+	EShooterBotActivity Activity = EShooterBotActivity::Walk;
+	float ActivityTimeRemaining = 0.f;
+	float FireTimeRemaining = 0.f;
+	FVector WalkDirection = FVector::ForwardVector;
+	float LookWander = 0.f;
+	bool bActivityPressPending = false;
+	TWeakObjectPtr<AActor> HopTarget;
+	float HopTimeSinceJump = -1.f;
+};
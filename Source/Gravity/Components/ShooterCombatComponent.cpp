@@ -34,6 +34,10 @@ void UShooterCombatComponent::BeginPlay()
 			WeaponSocket->AttachActor(DefaultWeapon, Shooter->GetMesh());
 			EquippedWeapon = DefaultWeapon;
 			EquippedWeapon->SetOwner(Shooter);
+			if(Shooter->IsLocallyControlled())
+			{
+				EquippedWeapon->WarmBulletPool();
+			}
 		}
 	}
 	SetHUDCrossHairs();
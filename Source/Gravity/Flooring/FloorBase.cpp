@@ -3,6 +3,9 @@
 
 #include "FloorBase.h"
 
+#include "Components/StaticMeshComponent.h"
+#include "Gravity/Subsystems/GravitySourceSubsystem.h"
+
 
 AFloorBase::AFloorBase()
 {
@@ -12,10 +15,18 @@ AFloorBase::AFloorBase()
 void AFloorBase::BeginPlay()
 {
 	Super::BeginPlay();
-}
-
-
-
-
 
+	if(UGravitySourceSubsystem* GravitySources = GetWorld()->GetSubsystem<UGravitySourceSubsystem>())
+	{
+		GravitySources->RegisterSource(this, GetStaticMeshComponent(), GravityShape);
+	}
+}
 
+void AFloorBase::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if(UGravitySourceSubsystem* GravitySources = GetWorld()->GetSubsystem<UGravitySourceSubsystem>())
+	{
+		GravitySources->UnregisterSource(this);
+	}
+	Super::EndPlay(EndPlayReason);
+}
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "Engine/StaticMeshActor.h"
+#include "Gravity/GravityTypes/GravitySourceShape.h"
 #include "FloorBase.generated.h"
 
 
@@ -21,6 +22,11 @@ public:
 
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	//box shaped floors can skip the physics sweep when finding the closest point
+	UPROPERTY(EditAnywhere, Category = Gravity)
+	EGravitySourceShape GravityShape = EGravitySourceShape::Mesh;
 	
 private:
 
@@ -5,10 +5,11 @@
 
 ASphereFloorBase::ASphereFloorBase()
 {
+	GravityShape = EGravitySourceShape::Sphere;
 }
 
 void ASphereFloorBase::BeginPlay()
 {
-	
+	Super::BeginPlay();
 }
 
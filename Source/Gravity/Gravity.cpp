@@ -1,6 +1,33 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "Gravity.h"
+#include "GravityStats.h"
 #include "Modules/ModuleManager.h"
 
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, Gravity, "Gravity" );
+
+DEFINE_LOG_CATEGORY(LogGravity);
+
+DEFINE_STAT(STAT_GravityShooterMovement);
+DEFINE_STAT(STAT_GravityFindClosestFloor);
+DEFINE_STAT(STAT_GravityOrientToGravity);
+DEFINE_STAT(STAT_GravityGravityForce);
+DEFINE_STAT(STAT_GravityServerSendMove);
+DEFINE_STAT(STAT_GravityServerMoves);
+DEFINE_STAT(STAT_GravityOnRepStatusOnServer);
+DEFINE_STAT(STAT_GravityPlayUnacknowledgedMoves);
+DEFINE_STAT(STAT_GravityProjectiles);
+DEFINE_STAT(STAT_GravityHitscan);
+DEFINE_STAT(STAT_GravityRecordHitboxes);
+DEFINE_STAT(STAT_GravityFloorQueries);
+DEFINE_STAT(STAT_GravityFloorSweeps);
+DEFINE_STAT(STAT_GravityCorrections);
+DEFINE_STAT(STAT_GravityProjectilesInFlight);
+DEFINE_STAT(STAT_GravityMovementSteps);
+DEFINE_STAT(STAT_GravityComponentTransformUpdates);
+DEFINE_STAT(STAT_GravityCorrectionsPerMinute);
+DEFINE_STAT(STAT_GravityStatusBytesPerUpdate);
+DEFINE_STAT(STAT_GravityStatusPropertyBytesPerUpdate);
+DEFINE_STAT(STAT_GravityReplayedMovesPerSecond);
+DEFINE_STAT(STAT_GravityMeanReplayTimeMs);
+DEFINE_STAT(STAT_GravityFloorCacheHitRate);
@@ -4,3 +4,4 @@
 
 #include "CoreMinimal.h"
 
+GRAVITY_API DECLARE_LOG_CATEGORY_EXTERN(LogGravity, Log, All);
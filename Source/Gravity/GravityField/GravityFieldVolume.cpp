@@ -0,0 +1,206 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityFieldVolume.h"
+
+#include "EngineUtils.h"
+#include "Components/BoxComponent.h"
+#include "Components/PrimitiveComponent.h"
+#include "Gravity/Gravity.h"
+#include "Gravity/Movement/ShooterWorldQuery.h"
+#include "Gravity/Sphere/GravitySphere.h"
+#include "Gravity/Subsystems/GravitySourceSubsystem.h"
+
+AGravityFieldVolume::AGravityFieldVolume()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	FieldBounds = CreateDefaultSubobject<UBoxComponent>(TEXT("FieldBounds"));
+	FieldBounds->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	FieldBounds->SetBoxExtent(FVector(10000.f));
+	SetRootComponent(FieldBounds);
+}
+
+void AGravityFieldVolume::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if(UGravitySourceSubsystem* GravitySources = GetWorld()->GetSubsystem<UGravitySourceSubsystem>())
+	{
+		GravitySources->RegisterField(this);
+	}
+}
+
+void AGravityFieldVolume::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if(UGravitySourceSubsystem* GravitySources = GetWorld()->GetSubsystem<UGravitySourceSubsystem>())
+	{
+		GravitySources->UnregisterField(this);
+	}
+	Super::EndPlay(EndPlayReason);
+}
+
+bool AGravityFieldVolume::Sample(const FVector& Location, const float InGravityDistanceRadius, const float InSphereTraceRadius, FShooterFloorQueryResult& OutResult) const
+{
+	if(!IsBaked() || InGravityDistanceRadius != BakedGravityDistanceRadius || InSphereTraceRadius != BakedSphereTraceRadius)
+	{
+		return false;
+	}
+	const FVector GridLocation = (Location - BakedOrigin) / BakedVoxelSize;
+	const FIntVector Base(FMath::FloorToInt(GridLocation.X), FMath::FloorToInt(GridLocation.Y), FMath::FloorToInt(GridLocation.Z));
+	if(Base.X < 0 || Base.Y < 0 || Base.Z < 0 || Base.X >= PointCounts.X - 1 || Base.Y >= PointCounts.Y - 1 || Base.Z >= PointCounts.Z - 1)
+	{
+		return false;
+	}
+	const FVector Alpha = GridLocation - FVector(Base);
+
+	//trilinear blend of the offsets to the surface, only valid while all 8 corners see the same floor
+	FVector ToSurface = FVector::ZeroVector;
+	int32 FloorIndex = INDEX_NONE;
+	for(int32 Corner = 0; Corner < 8; Corner++)
+	{
+		const FIntVector CornerOffset(Corner & 1, (Corner >> 1) & 1, (Corner >> 2) & 1);
+		const FGravityFieldSample* CornerSample = FindSample(Base + CornerOffset);
+		if(CornerSample == nullptr || CornerSample->FloorIndex == INDEX_NONE)
+		{
+			return false;
+		}
+		if(FloorIndex != INDEX_NONE && CornerSample->FloorIndex != FloorIndex)
+		{
+			return false;
+		}
+		FloorIndex = CornerSample->FloorIndex;
+		const float Weight =
+			(CornerOffset.X ? Alpha.X : 1.f - Alpha.X) *
+			(CornerOffset.Y ? Alpha.Y : 1.f - Alpha.Y) *
+			(CornerOffset.Z ? Alpha.Z : 1.f - Alpha.Z);
+		ToSurface += FVector(CornerSample->ToSurface) * Weight;
+	}
+	AActor* Floor = BakedFloors.IsValidIndex(FloorIndex) ? BakedFloors[FloorIndex] : nullptr;
+	const float Distance = ToSurface.Size();
+	if(Floor == nullptr || Distance > BakedGravityDistanceRadius)
+	{
+		return false;
+	}
+	const FVector ImpactPoint = Location + ToSurface;
+	FShooterWorldQuery::MakeSurfaceHit(Location, ImpactPoint, -ToSurface.GetSafeNormal(), BakedSphereTraceRadius, Floor, Cast<UPrimitiveComponent>(Floor->GetRootComponent()), OutResult.FloorHitResult);
+	OutResult.Floor = Floor;
+	OutResult.Distance = Distance;
+	return true;
+}
+
+bool AGravityFieldVolume::Covers(const FVector& Location) const
+{
+	const FVector BakedMax = BakedOrigin + FVector(PointCounts - FIntVector(1)) * BakedVoxelSize;
+	return IsBaked() && FBox(BakedOrigin, BakedMax).IsInsideOrOn(Location);
+}
+
+const FGravityFieldSample* AGravityFieldVolume::FindSample(const FIntVector& Point) const
+{
+	const FIntVector Brick(Point.X / BrickSize, Point.Y / BrickSize, Point.Z / BrickSize);
+	const int32 BrickIndex = BrickIndices[Brick.X + BrickCounts.X * (Brick.Y + BrickCounts.Y * Brick.Z)];
+	if(BrickIndex == INDEX_NONE)
+	{
+		return nullptr;
+	}
+	const FIntVector InBrick = Point - Brick * BrickSize;
+	return &Bricks[BrickIndex].Samples[InBrick.X + BrickSize * (InBrick.Y + BrickSize * InBrick.Z)];
+}
+
+#if WITH_EDITOR
+void AGravityFieldVolume::BakeField()
+{
+	UWorld* World = GetWorld();
+	if(World == nullptr || VoxelSize <= 0.f)
+	{
+		return;
+	}
+	Modify();
+	ClearField();
+
+	const FBox Box = FieldBounds->Bounds.GetBox();
+	BakedOrigin = Box.Min;
+	BakedVoxelSize = VoxelSize;
+	BakedGravityDistanceRadius = GravityDistanceRadius;
+	BakedSphereTraceRadius = SphereTraceRadius;
+	const FVector Size = Box.GetSize();
+	PointCounts = FIntVector(
+		FMath::CeilToInt(Size.X / VoxelSize) + 1,
+		FMath::CeilToInt(Size.Y / VoxelSize) + 1,
+		FMath::CeilToInt(Size.Z / VoxelSize) + 1);
+	BrickCounts = FIntVector(
+		FMath::DivideAndRoundUp(PointCounts.X, BrickSize),
+		FMath::DivideAndRoundUp(PointCounts.Y, BrickSize),
+		FMath::DivideAndRoundUp(PointCounts.Z, BrickSize));
+	BrickIndices.Init(INDEX_NONE, BrickCounts.X * BrickCounts.Y * BrickCounts.Z);
+
+	//the level sphere a pawn uses is whichever gravity sphere it's inside, the smallest one when they nest
+	TArray<AGravitySphere*> GravitySpheres;
+	for(TActorIterator<AGravitySphere> It(World); It; ++It)
+	{
+		GravitySpheres.Add(*It);
+	}
+	GravitySpheres.Sort([](const AGravitySphere& A, const AGravitySphere& B) { return A.GetGravityRadius() < B.GetGravityRadius(); });
+	auto FindLevelSphere = [&GravitySpheres](const FVector& Location) -> const AActor*
+	{
+		for(const AGravitySphere* GravitySphere : GravitySpheres)
+		{
+			if(FVector::DistSquared(Location, GravitySphere->GetActorLocation()) < FMath::Square(GravitySphere->GetGravityRadius()))
+			{
+				return GravitySphere;
+			}
+		}
+		return nullptr;
+	};
+
+	FGravityFieldBrick Brick;
+	for(int32 BrickZ = 0; BrickZ < BrickCounts.Z; BrickZ++)
+	{
+		for(int32 BrickY = 0; BrickY < BrickCounts.Y; BrickY++)
+		{
+			for(int32 BrickX = 0; BrickX < BrickCounts.X; BrickX++)
+			{
+				Brick.Samples.Init(FGravityFieldSample(), BrickSize * BrickSize * BrickSize);
+				bool bBrickHasFloor = false;
+				for(int32 SampleIndex = 0; SampleIndex < Brick.Samples.Num(); SampleIndex++)
+				{
+					const FIntVector Point(
+						BrickX * BrickSize + SampleIndex % BrickSize,
+						BrickY * BrickSize + (SampleIndex / BrickSize) % BrickSize,
+						BrickZ * BrickSize + SampleIndex / (BrickSize * BrickSize));
+					if(Point.X >= PointCounts.X || Point.Y >= PointCounts.Y || Point.Z >= PointCounts.Z)
+					{
+						continue;
+					}
+					const FVector Location = BakedOrigin + FVector(Point) * VoxelSize;
+					//the editor world has no registry, so this is the same physics query pawns fall back to
+					const FShooterWorldQuery WorldQuery(World, FindLevelSphere(Location), GravityDistanceRadius, SphereTraceRadius);
+					FShooterFloorQueryResult QueryResult;
+					if(WorldQuery.FindClosestFloor(Location, FLT_MAX, QueryResult) && QueryResult.Floor)
+					{
+						FGravityFieldSample& FieldSample = Brick.Samples[SampleIndex];
+						FieldSample.ToSurface = FVector3f(QueryResult.FloorHitResult.ImpactPoint - Location);
+						FieldSample.FloorIndex = BakedFloors.AddUnique(QueryResult.Floor);
+						bBrickHasFloor = true;
+					}
+				}
+				if(bBrickHasFloor)
+				{
+					BrickIndices[BrickX + BrickCounts.X * (BrickY + BrickCounts.Y * BrickZ)] = Bricks.Add(Brick);
+				}
+			}
+		}
+	}
+	UE_LOG(LogGravity, Log, TEXT("%s baked %d of %d bricks, %d floors"), *GetName(), Bricks.Num(), BrickIndices.Num(), BakedFloors.Num());
+}
+
+void AGravityFieldVolume::ClearField()
+{
+	Modify();
+	PointCounts = FIntVector::ZeroValue;
+	BrickCounts = FIntVector::ZeroValue;
+	BrickIndices.Empty();
+	Bricks.Empty();
+	BakedFloors.Empty();
+}
+#endif
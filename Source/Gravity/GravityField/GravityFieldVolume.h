@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "GravityFieldVolume.generated.h"
+
+class UBoxComponent;
+struct FShooterFloorQueryResult;
+
+USTRUCT()
+struct FGravityFieldSample
+{
+	GENERATED_BODY()
+
+	//offset from the sample point to the closest floor surface
+	UPROPERTY()
+	FVector3f ToSurface = FVector3f::ZeroVector;
+	UPROPERTY()
+	int32 FloorIndex = INDEX_NONE;
+};
+
+USTRUCT()
+struct FGravityFieldBrick
+{
+	GENERATED_BODY()
+
+	//BrickSize^3 samples, x fastest
+	UPROPERTY()
+	TArray<FGravityFieldSample> Samples;
+};
+
+/**
+ * Closest floor for every point of a static level, baked in the editor into a sparse grid of bricks.
+ * Bricks with no floor in range aren't stored. The field only answers for pawns using the gravity radii it was baked with.
+ */
+UCLASS()
+class GRAVITY_API AGravityFieldVolume : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AGravityFieldVolume();
+
+	static constexpr int32 BrickSize = 8;
+
+	//false when the location isn't covered or the surrounding samples disagree on the floor, the caller should do a live query
+	bool Sample(const FVector& Location, float GravityDistanceRadius, float SphereTraceRadius, FShooterFloorQueryResult& OutResult) const;
+
+	FORCEINLINE bool IsBaked() const { return BrickIndices.Num() > 0; }
+	bool Covers(const FVector& Location) const;
+
+#if WITH_EDITOR
+	UFUNCTION(CallInEditor, Category = Gravity)
+	void BakeField();
+	UFUNCTION(CallInEditor, Category = Gravity)
+	void ClearField();
+#endif
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	UPROPERTY(EditAnywhere)
+	UBoxComponent* FieldBounds;
+
+	UPROPERTY(EditAnywhere, Category = Gravity)
+	float VoxelSize = 250.f;
+	//these have to match the pawn's gravity settings for the field to be used
+	UPROPERTY(EditAnywhere, Category = Gravity)
+	float GravityDistanceRadius = 2500.f;
+	UPROPERTY(EditAnywhere, Category = Gravity)
+	float SphereTraceRadius = 750.f;
+
+private:
+	const FGravityFieldSample* FindSample(const FIntVector& Point) const;
+
+	UPROPERTY()
+	FVector BakedOrigin = FVector::ZeroVector;
+	UPROPERTY()
+	float BakedVoxelSize = 0.f;
+	UPROPERTY()
+	float BakedGravityDistanceRadius = 0.f;
+	UPROPERTY()
+	float BakedSphereTraceRadius = 0.f;
+	//number of sample points and bricks along each axis
+	UPROPERTY()
+	FIntVector PointCounts = FIntVector::ZeroValue;
+	UPROPERTY()
+	FIntVector BrickCounts = FIntVector::ZeroValue;
+	//one entry per brick in the box, INDEX_NONE for bricks without a floor in range
+	UPROPERTY()
+	TArray<int32> BrickIndices;
+	UPROPERTY()
+	TArray<FGravityFieldBrick> Bricks;
+	UPROPERTY()
+	TArray<AActor*> BakedFloors;
+};
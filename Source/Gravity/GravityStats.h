@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Stats/Stats.h"
+
+DECLARE_STATS_GROUP(TEXT("Gravity"), STATGROUP_Gravity, STATCAT_Advanced);
+
+//stat Gravity and an Unreal Insights scope under the same name
+#define GRAVITY_SCOPE_CYCLE_COUNTER(Stat) \
+	SCOPE_CYCLE_COUNTER(Stat); \
+	TRACE_CPUPROFILER_EVENT_SCOPE(Stat)
+
+//on screen debug text and debug drawing, never in Shipping or Test
+#define GRAVITY_DEBUG_DISPLAY (!(UE_BUILD_SHIPPING || UE_BUILD_TEST))
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("ShooterMovement"), STAT_GravityShooterMovement, STATGROUP_Gravity, GRAVITY_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("FindClosestFloor"), STAT_GravityFindClosestFloor, STATGROUP_Gravity, GRAVITY_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("OrientToGravity"), STAT_GravityOrientToGravity, STATGROUP_Gravity, GRAVITY_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("GravityForce"), STAT_GravityGravityForce, STATGROUP_Gravity, GRAVITY_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("ServerSendMove"), STAT_GravityServerSendMove, STATGROUP_Gravity, GRAVITY_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("ServerMoves"), STAT_GravityServerMoves, STATGROUP_Gravity, GRAVITY_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("OnRep_StatusOnServer"), STAT_GravityOnRepStatusOnServer, STATGROUP_Gravity, GRAVITY_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("PlayUnacknowledgedMoves"), STAT_GravityPlayUnacknowledgedMoves, STATGROUP_Gravity, GRAVITY_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Projectiles"), STAT_GravityProjectiles, STATGROUP_Gravity, GRAVITY_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Hitscan"), STAT_GravityHitscan, STATGROUP_Gravity, GRAVITY_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("RecordHitboxes"), STAT_GravityRecordHitboxes, STATGROUP_Gravity, GRAVITY_API);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Floor Queries"), STAT_GravityFloorQueries, STATGROUP_Gravity, GRAVITY_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Floor Sweeps"), STAT_GravityFloorSweeps, STATGROUP_Gravity, GRAVITY_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Corrections"), STAT_GravityCorrections, STATGROUP_Gravity, GRAVITY_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Projectiles In Flight"), STAT_GravityProjectilesInFlight, STATGROUP_Gravity, GRAVITY_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Movement Steps"), STAT_GravityMovementSteps, STATGROUP_Gravity, GRAVITY_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Component Transform Updates"), STAT_GravityComponentTransformUpdates, STATGROUP_Gravity, GRAVITY_API);
+
+
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Corrections Per Minute"), STAT_GravityCorrectionsPerMinute, STATGROUP_Gravity, GRAVITY_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Status Bytes Per Update"), STAT_GravityStatusBytesPerUpdate, STATGROUP_Gravity, GRAVITY_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Status Bytes Per Update (Per Property)"), STAT_GravityStatusPropertyBytesPerUpdate, STATGROUP_Gravity, GRAVITY_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Replayed Moves Per Second"), STAT_GravityReplayedMovesPerSecond, STATGROUP_Gravity, GRAVITY_API);
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Mean Replay Time (ms)"), STAT_GravityMeanReplayTimeMs, STATGROUP_Gravity, GRAVITY_API);
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Floor Cache Hit Rate (%)"), STAT_GravityFloorCacheHitRate, STATGROUP_Gravity, GRAVITY_API);
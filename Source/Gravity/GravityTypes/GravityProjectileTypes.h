@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+#include "GravityProjectileTypes.generated.h"
+
+class UStaticMesh;
+
+UENUM()
+enum class EWeaponFireMode : uint8
+{
+	//pooled bullet actors, only ever seen by the shooter
+	BulletActor,
+	//flown by the world's projectile subsystem on every machine, the server's copy hits
+	Projectile,
+	//instant, the server checks it against where everyone's hit boxes were when it was fired
+	Hitscan,
+};
+
+/**
+ * How a weapon's projectiles fly, every machine reads these from its own copy of the weapon.
+ */
+USTRUCT()
+struct FGravityProjectileParams
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere)
+	float Speed = 10000.f;
+	UPROPERTY(EditAnywhere)
+	float Damage = 20.f;
+	UPROPERTY(EditAnywhere)
+	float Lifetime = 3.f;
+	UPROPERTY(EditAnywhere)
+	TEnumAsByte<ECollisionChannel> TraceChannel = ECC_Visibility;
+	//curve toward the closest floor the same way pawns are pulled
+	UPROPERTY(EditAnywhere)
+	bool bAffectedByGravity = false;
+	UPROPERTY(EditAnywhere, meta=(EditCondition="bAffectedByGravity"))
+	float GravityStrength = 3000.f;
+	UPROPERTY(EditAnywhere, meta=(EditCondition="bAffectedByGravity"))
+	float GravityDistanceRadius = 2500.f;
+	//left empty, the weapon takes the mesh from its bullet blueprint
+	UPROPERTY(EditAnywhere)
+	UStaticMesh* Mesh = nullptr;
+};
+
+/**
+ * All a shot needs on the wire, the rest comes from the firing pawn's weapon.
+ */
+USTRUCT()
+struct FGravityProjectileSpawn
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FVector_NetQuantize Origin = FVector::ZeroVector;
+	UPROPERTY()
+	FVector_NetQuantizeNormal Direction = FVector::ForwardVector;
+};
+
+/**
+ * How a weapon's hitscan shots hit, only the server's copy of these decides damage.
+ */
+USTRUCT()
+struct FGravityHitscanParams
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere)
+	float Range = 20000.f;
+	UPROPERTY(EditAnywhere)
+	float Damage = 20.f;
+	UPROPERTY(EditAnywhere)
+	float HeadshotMultiplier = 2.f;
+};
@@ -0,0 +1,10 @@
+﻿#pragma once
+
+//how the floor query finds the closest point on a gravity source
+UENUM()
+enum class EGravitySourceShape : uint8
+{
+	Mesh UMETA(DisplayName = "Mesh (Physics Sweep)"),
+	Sphere UMETA(DisplayName = "Sphere"),
+	Box UMETA(DisplayName = "Oriented Box"),
+};
\ No newline at end of file
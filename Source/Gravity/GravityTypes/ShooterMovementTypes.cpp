@@ -0,0 +1,363 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterMovementTypes.h"
+
+#include "Engine/NetSerialization.h"
+#include "GameFramework/Actor.h"
+#include "Gravity/GravityStats.h"
+#include "Serialization/BitWriter.h"
+
+namespace ShooterStatusNet
+{
+	//one bit per optional field, a cleared bit means the receiver already has the field
+	enum EField : uint16
+	{
+		Velocity = 1 << 0,
+		LookRotation = 1 << 1,
+		SpringArm = 1 << 2,
+		JumpForce = 1 << 3,
+		SphereLastVelocity = 1 << 4,
+		BoostRecharge = 1 << 5,
+		Gravity = 1 << 6,
+		ClosestDistance = 1 << 7,
+		ClosestFloor = 1 << 8,
+		CurrentFloor = 1 << 9,
+		FloorCache = 1 << 10,
+	};
+	constexpr int64 NumFieldBits = 11;
+	constexpr uint16 AllFields = (1 << NumFieldBits) - 1;
+
+	//floor status and spin both fit in 2 bits, magnetized takes the 5th
+	constexpr int64 NumStateBits = 5;
+
+	//recharge time goes out in whole milliseconds
+	constexpr float BoostRechargeScale = 1000.f;
+
+	/**
+	 * What a connection was last sent, the engine hands it back as the base of the next update and falls back
+	 * to an older one when a packet is lost. Updates built on top of a state that never arrived may still have been
+	 * received, so every state remembers which fields went out after it and those are sent again if it comes back.
+	 */
+	struct FStatusBaseState : public INetDeltaBaseState, public TSharedFromThis<FStatusBaseState>
+	{
+		FShooterStatus Status;
+		uint16 FieldsSentSince = 0;
+		TWeakPtr<FStatusBaseState> Base;
+
+		virtual bool IsStateEqual(INetDeltaBaseState* OtherState) override
+		{
+			const FStatusBaseState* Other = static_cast<FStatusBaseState*>(OtherState);
+			return FieldsSentSince == Other->FieldsSentSince && Status.IsWireEqual(Other->Status);
+		}
+	};
+
+	//fields away from their resting value, for anything that has no base to compare against
+	uint16 GetRestingFields(const FShooterStatus& Status)
+	{
+		uint16 Fields = 0;
+		if(!Status.CurrentVelocity.IsZero()) Fields |= Velocity;
+		if(Status.LastPitchRotation != 0.f || Status.LastYawRotation != 0.f) Fields |= LookRotation;
+		if(Status.SpringArmPitch != 0.f || Status.SpringArmYaw != 0.f) Fields |= SpringArm;
+		if(!Status.JumpForce.IsZero()) Fields |= JumpForce;
+		if(!Status.SphereLastVelocity.IsZero()) Fields |= SphereLastVelocity;
+		if(Status.BoostRechargeTimeRemaining > 0.f) Fields |= BoostRecharge;
+		if(!Status.CurrentGravity.IsZero() || !Status.SphereLocation.IsZero()) Fields |= Gravity;
+		if(Status.ClosestDistanceToFloor != FLT_MAX) Fields |= ClosestDistance;
+		if(Status.ClosestFloor) Fields |= ClosestFloor;
+		if(Status.CurrentFloor) Fields |= CurrentFloor;
+		if(Status.FloorCacheSteps != 0 || !Status.FloorCacheLocation.IsZero()) Fields |= FloorCache;
+		return Fields;
+	}
+
+	uint16 GetChangedFields(const FShooterStatus& Status, const FShooterStatus& Base)
+	{
+		uint16 Fields = 0;
+		if(Status.CurrentVelocity != Base.CurrentVelocity) Fields |= Velocity;
+		if(Status.LastPitchRotation != Base.LastPitchRotation || Status.LastYawRotation != Base.LastYawRotation) Fields |= LookRotation;
+		if(Status.SpringArmPitch != Base.SpringArmPitch || Status.SpringArmYaw != Base.SpringArmYaw) Fields |= SpringArm;
+		if(Status.JumpForce != Base.JumpForce) Fields |= JumpForce;
+		if(Status.SphereLastVelocity != Base.SphereLastVelocity) Fields |= SphereLastVelocity;
+		if(Status.BoostRechargeTimeRemaining != Base.BoostRechargeTimeRemaining) Fields |= BoostRecharge;
+		if(Status.CurrentGravity != Base.CurrentGravity || Status.SphereLocation != Base.SphereLocation) Fields |= Gravity;
+		if(Status.ClosestDistanceToFloor != Base.ClosestDistanceToFloor) Fields |= ClosestDistance;
+		if(Status.ClosestFloor != Base.ClosestFloor) Fields |= ClosestFloor;
+		if(Status.CurrentFloor != Base.CurrentFloor) Fields |= CurrentFloor;
+		if(Status.FloorCacheSteps != Base.FloorCacheSteps || Status.FloorCacheLocation != Base.FloorCacheLocation) Fields |= FloorCache;
+		return Fields;
+	}
+
+	//the fields every update carries
+	bool AreHotFieldsEqual(const FShooterStatus& Status, const FShooterStatus& Base)
+	{
+		return Status.ShooterLocation == Base.ShooterLocation &&
+			Status.ShooterRotation == Base.ShooterRotation &&
+			Status.LastMove.Sequence == Base.LastMove.Sequence &&
+			Status.ServerTime == Base.ServerTime &&
+			Status.BoostCount == Base.BoostCount &&
+			Status.ShooterFloorStatus == Base.ShooterFloorStatus &&
+			Status.ShooterSpin == Base.ShooterSpin &&
+			Status.bMagnetized == Base.bMagnetized;
+	}
+
+	bool SerializeActor(FArchive& Ar, UPackageMap* Map, AActor*& Actor)
+	{
+		if(Map == nullptr)
+		{
+			return false;
+		}
+		UObject* Object = Actor;
+		const bool bSuccess = Map->SerializeObject(Ar, AActor::StaticClass(), Object);
+		if(Ar.IsLoading())
+		{
+			Actor = Cast<AActor>(Object);
+		}
+		return bSuccess;
+	}
+
+#if STATS
+	//what replicating every UPROPERTY as is costs when they all change, actor references count as a packed net GUID and handles aren't counted
+	int64 CountPropertyBits(const UStruct* Struct, void* Data)
+	{
+		constexpr int64 NetGUIDBits = 32;
+		FBitWriter Writer(0, true);
+		int64 Bits = 0;
+		for(TFieldIterator<FProperty> It(Struct); It; ++It)
+		{
+			const FProperty* Property = *It;
+			if(Property->HasAnyPropertyFlags(CPF_RepSkip))
+			{
+				continue;
+			}
+			const FStructProperty* StructProperty = CastField<FStructProperty>(Property);
+			for(int32 ArrayIndex = 0; ArrayIndex < Property->ArrayDim; ArrayIndex++)
+			{
+				void* Value = Property->ContainerPtrToValuePtr<void>(Data, ArrayIndex);
+				if(Property->IsA<FObjectPropertyBase>())
+				{
+					Bits += NetGUIDBits;
+				}
+				else if(StructProperty && !(StructProperty->Struct->StructFlags & STRUCT_NetSerializeNative))
+				{
+					Bits += CountPropertyBits(StructProperty->Struct, Value);
+				}
+				else
+				{
+					Property->NetSerializeItem(Writer, nullptr, Value);
+				}
+			}
+		}
+		return Bits + Writer.GetNumBits();
+	}
+#endif
+}
+
+bool FShooterStatus::IsWireEqual(const FShooterStatus& Other) const
+{
+	return ShooterStatusNet::AreHotFieldsEqual(*this, Other) && ShooterStatusNet::GetChangedFields(*this, Other) == 0;
+}
+
+bool FShooterStatus::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	const uint16 Fields = Ar.IsSaving() ? ShooterStatusNet::GetRestingFields(*this) : 0;
+	//a field that isn't sent is at its resting value
+	bOutSuccess = SerializeFields(Ar, Map, Fields, true);
+	return true;
+}
+
+bool FShooterStatus::NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+{
+	using namespace ShooterStatusNet;
+
+	if(DeltaParms.Writer)
+	{
+		FStatusBaseState* OldState = static_cast<FStatusBaseState*>(DeltaParms.OldState);
+		uint16 Fields = AllFields;
+		if(OldState)
+		{
+			Fields = GetChangedFields(*this, OldState->Status) | OldState->FieldsSentSince;
+			if(Fields == 0 && AreHotFieldsEqual(*this, OldState->Status))
+			{
+				//no new server status since the last update
+				return false;
+			}
+		}
+		FBitWriter& Writer = *DeltaParms.Writer;
+		const int64 StartBits = Writer.GetNumBits();
+		SerializeFields(Writer, DeltaParms.Map, Fields, false);
+		SET_DWORD_STAT(STAT_GravityStatusBytesPerUpdate, FMath::DivideAndRoundUp<int64>(Writer.GetNumBits() - StartBits, 8));
+#if STATS
+		if(FThreadStats::IsCollectingData())
+		{
+			FShooterStatus Measured = *this;
+			SET_DWORD_STAT(STAT_GravityStatusPropertyBytesPerUpdate, FMath::DivideAndRoundUp<int64>(CountPropertyBits(StaticStruct(), &Measured), 8));
+		}
+#endif
+
+		//the old state and everything it was built on have now had these fields sent after them
+		TSharedPtr<FStatusBaseState> SentBase = OldState ? OldState->AsShared() : nullptr;
+		for(TSharedPtr<FStatusBaseState> State = SentBase; State.IsValid(); State = State->Base.Pin())
+		{
+			State->FieldsSentSince |= Fields;
+		}
+		TSharedRef<FStatusBaseState> NewState = MakeShared<FStatusBaseState>();
+		NewState->Status = *this;
+		NewState->Base = SentBase;
+		*DeltaParms.NewState = NewState;
+		return true;
+	}
+	if(DeltaParms.Reader)
+	{
+		//a field that isn't sent is the one we already have
+		SerializeFields(*DeltaParms.Reader, DeltaParms.Map, 0, false);
+		return true;
+	}
+	//actor references aren't tracked while unmapped, floors are placed in the level and always resolve
+	return false;
+}
+
+bool FShooterStatus::SerializeFields(FArchive& Ar, UPackageMap* Map, uint16 Fields, const bool bResetMissingFields)
+{
+	using namespace ShooterStatusNet;
+
+	bool bOutSuccess = true;
+	Ar.SerializeBits(&Fields, NumFieldBits);
+
+
+	//hot fields, every update carries these
+	bOutSuccess &= SerializePackedVector<10, 24>(ShooterLocation, Ar);
+	ShooterRotation.SerializeCompressedShort(Ar);
+	Ar << LastMove.Sequence;
+	Ar << ServerTime;
+	Ar << BoostCount;
+
+	uint8 State = 0;
+	if(Ar.IsSaving())
+	{
+		State = static_cast<uint8>(ShooterFloorStatus) | static_cast<uint8>(ShooterSpin) << 2 | (bMagnetized ? 1 << 4 : 0);
+	}
+	Ar.SerializeBits(&State, NumStateBits);
+	if(Ar.IsLoading())
+	{
+		ShooterFloorStatus = static_cast<EShooterFloorStatus>(State & 0x3);
+		ShooterSpin = static_cast<EShooterSpin>(FMath::Min<uint8>(State >> 2 & 0x3, static_cast<uint8>(EShooterSpin::NoFlip)));
+		bMagnetized = (State & 1 << 4) != 0;
+	}
+
+	//velocities are per step, so they need the finer scale
+	if(Fields & Velocity)
+	{
+		bOutSuccess &= SerializePackedVector<100, 30>(CurrentVelocity, Ar);
+	}
+	else if(bResetMissingFields && Ar.IsLoading())
+	{
+		CurrentVelocity = FVector::ZeroVector;
+	}
+
+	if(Fields & LookRotation)
+	{
+		FRotator LookRotator(LastPitchRotation, LastYawRotation, 0.f);
+		LookRotator.SerializeCompressedShort(Ar);
+		LastPitchRotation = FRotator::NormalizeAxis(LookRotator.Pitch);
+		LastYawRotation = FRotator::NormalizeAxis(LookRotator.Yaw);
+	}
+	else if(bResetMissingFields && Ar.IsLoading())
+	{
+		LastPitchRotation = 0.f;
+		LastYawRotation = 0.f;
+	}
+
+	if(Fields & SpringArm)
+	{
+		FRotator SpringArmRotator(SpringArmPitch, SpringArmYaw, 0.f);
+		SpringArmRotator.SerializeCompressedShort(Ar);
+		SpringArmPitch = FRotator::NormalizeAxis(SpringArmRotator.Pitch);
+		SpringArmYaw = FRotator::NormalizeAxis(SpringArmRotator.Yaw);
+	}
+	else if(bResetMissingFields && Ar.IsLoading())
+	{
+		SpringArmPitch = 0.f;
+		SpringArmYaw = 0.f;
+	}
+
+	if(Fields & ShooterStatusNet::JumpForce)
+	{
+		bOutSuccess &= SerializePackedVector<100, 30>(JumpForce, Ar);
+	}
+	else if(bResetMissingFields && Ar.IsLoading())
+	{
+		JumpForce = FVector::ZeroVector;
+	}
+
+	if(Fields & ShooterStatusNet::SphereLastVelocity)
+	{
+		bOutSuccess &= SerializePackedVector<100, 30>(SphereLastVelocity, Ar);
+	}
+	else if(bResetMissingFields && Ar.IsLoading())
+	{
+		SphereLastVelocity = FVector::ZeroVector;
+	}
+
+	if(Fields & BoostRecharge)
+	{
+		uint16 RechargeMilliseconds = FMath::Clamp<int32>(FMath::RoundToInt(BoostRechargeTimeRemaining * BoostRechargeScale), 0, MAX_uint16);
+		Ar << RechargeMilliseconds;
+		BoostRechargeTimeRemaining = RechargeMilliseconds / BoostRechargeScale;
+	}
+	else if(bResetMissingFields && Ar.IsLoading())
+	{
+		BoostRechargeTimeRemaining = 0.f;
+	}
+
+	if(Fields & Gravity)
+	{
+		bOutSuccess &= SerializePackedVector<10, 24>(CurrentGravity, Ar);
+		bOutSuccess &= SerializePackedVector<10, 24>(SphereLocation, Ar);
+	}
+	else if(bResetMissingFields && Ar.IsLoading())
+	{
+		CurrentGravity = FVector::ZeroVector;
+		SphereLocation = FVector::ZeroVector;
+	}
+
+	if(Fields & ClosestDistance)
+	{
+		Ar << ClosestDistanceToFloor;
+	}
+	else if(bResetMissingFields && Ar.IsLoading())
+	{
+		ClosestDistanceToFloor = FLT_MAX;
+	}
+
+	if(Fields & ShooterStatusNet::ClosestFloor)
+	{
+		bOutSuccess &= SerializeActor(Ar, Map, ClosestFloor);
+	}
+	else if(bResetMissingFields && Ar.IsLoading())
+	{
+		ClosestFloor = nullptr;
+	}
+
+	if(Fields & ShooterStatusNet::CurrentFloor)
+	{
+		bOutSuccess &= SerializeActor(Ar, Map, CurrentFloor);
+	}
+	else if(bResetMissingFields && Ar.IsLoading())
+	{
+		CurrentFloor = nullptr;
+	}
+
+	//the cache decides when the floor is queried again, a replay has to start from the server's
+	if(Fields & FloorCache)
+	{
+		bOutSuccess &= SerializePackedVector<10, 24>(FloorCacheLocation, Ar);
+		Ar << FloorCacheSteps;
+	}
+	else if(bResetMissingFields && Ar.IsLoading())
+	{
+		FloorCacheLocation = FVector::ZeroVector;
+		FloorCacheSteps = 0;
+	}
+
+	return bOutSuccess;
+}
@@ -0,0 +1,158 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/HitResult.h"
+#include "Gravity/GravityTypes/ShooterFloorStatus.h"
+#include "ShooterMovementTypes.generated.h"
+
+UENUM()
+enum class EShooterSpin : uint8
+{
+	FrontFlip UMETA(DisplayName = "Spin Forwards"),
+	BackFlip UMETA(DisplayName = "Spin Backwards"),
+	NoFlip UMETA(DisplayName = "Don't Spin"),
+};
+
+USTRUCT()
+struct FShooterMove
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FVector_NetQuantize MovementVector = FVector::ZeroVector;
+	UPROPERTY()
+	float PitchInput = 0.f;
+	UPROPERTY()
+	float YawInput = 0.f;
+	UPROPERTY()
+	FRotator ShooterRotationAfterMovement;
+	UPROPERTY()
+	float LastPitchRotation;
+	UPROPERTY()
+	float LastYawRotation;
+	UPROPERTY()
+	float SpringArmPitch;
+	UPROPERTY()
+	bool bJumped = false;
+	UPROPERTY()
+	bool bMagnetizedPressed = false;
+	UPROPERTY()
+	bool bBoost = false;
+	UPROPERTY()
+	FVector_NetQuantize BoostDirection = FVector::ZeroVector;
+	//floor contact is found by the client's capsule hits, the server takes it from the move
+	UPROPERTY()
+	EShooterFloorStatus FloorContact = EShooterFloorStatus::NoFloorContact;
+	UPROPERTY()
+	AActor* ContactFloor = nullptr;
+	//counts up by one for every move the client queues, wraps around
+	UPROPERTY()
+	uint16 Sequence = 0;
+	//how many identical steps this move stands for, idle steps get coalesced into one entry
+	UPROPERTY()
+	uint8 RepeatCount = 1;
+
+	FORCEINLINE bool IsIdle() const
+	{
+		return MovementVector.IsZero() && PitchInput == 0.f && YawInput == 0.f && !bJumped && !bMagnetizedPressed && !bBoost;
+	}
+
+	//a repeat of an idle move has to land in the same state, a landing or a floor change closes the run
+	FORCEINLINE bool CanCoalesceWith(const FShooterMove& Other) const
+	{
+		return IsIdle() && Other.IsIdle() &&
+			FloorContact == Other.FloorContact &&
+			ContactFloor == Other.ContactFloor &&
+			ShooterRotationAfterMovement == Other.ShooterRotationAfterMovement;
+	}
+};
+
+USTRUCT()
+struct FShooterMoveBundle
+{
+	GENERATED_BODY()
+
+	//oldest first, the newest move is always last
+	UPROPERTY()
+	TArray<FShooterMove> Moves;
+};
+
+USTRUCT()
+struct FShooterStatus
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FVector_NetQuantize ShooterLocation;
+	UPROPERTY()
+	FRotator ShooterRotation;
+	UPROPERTY()
+	float SpringArmPitch;
+	UPROPERTY()
+	float SpringArmYaw;
+	UPROPERTY()
+	float LastPitchRotation = 0.f;
+	UPROPERTY()
+	float LastYawRotation = 0.f;
+	UPROPERTY()
+	bool bMagnetized = false;
+	UPROPERTY()
+	int8 BoostCount;
+	UPROPERTY()
+	float BoostRechargeTimeRemaining = 0.f;
+	UPROPERTY()
+	FVector_NetQuantize CurrentVelocity = FVector::ZeroVector;
+	UPROPERTY()
+	FVector_NetQuantize JumpForce;
+	UPROPERTY()
+	FVector_NetQuantize SphereLastVelocity = FVector::ZeroVector;
+	UPROPERTY()
+    FShooterMove LastMove;
+	UPROPERTY()
+	EShooterFloorStatus ShooterFloorStatus;
+	UPROPERTY()
+	EShooterSpin ShooterSpin = EShooterSpin::NoFlip;
+	UPROPERTY()
+	float ClosestDistanceToFloor = FLT_MAX;
+	UPROPERTY()
+	AActor* ClosestFloor = nullptr;
+	UPROPERTY()
+	AActor* CurrentFloor = nullptr;
+	UPROPERTY()
+	FHitResult FloorHitResult;
+	UPROPERTY()
+	FVector_NetQuantize CurrentGravity;
+	UPROPERTY()
+	FVector_NetQuantize SphereLocation;
+	//server world time this status was made at, proxies are interpolated by it
+	UPROPERTY()
+	float ServerTime = 0.f;
+
+	//where and how many steps ago the closest floor was last fully queried, NetSerialize carries both
+	FVector FloorCacheLocation = FVector::ZeroVector;
+	uint8 FloorCacheSteps = 0;
+
+	//replication, quantized and only the fields that changed since the base state the engine keeps for each connection
+	//FloorHitResult and most of LastMove never go on the wire
+	bool NetDeltaSerialize(struct FNetDeltaSerializeInfo& DeltaParms);
+	//anything without a base state, the same encoding with only the fields away from their resting value
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+	//equal as far as the wire is concerned
+	bool IsWireEqual(const FShooterStatus& Other) const;
+
+private:
+	//fields missing from the mask are left alone unless bResetMissingFields, then they go back to their resting value
+	bool SerializeFields(FArchive& Ar, class UPackageMap* Map, uint16 Fields, bool bResetMissingFields);
+};
+
+template<>
+struct TStructOpsTypeTraits<FShooterStatus> : public TStructOpsTypeTraitsBase2<FShooterStatus>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithNetDeltaSerializer = true,
+	};
+};
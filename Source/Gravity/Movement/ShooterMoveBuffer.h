@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/StaticArray.h"
+#include "Gravity/GravityTypes/ShooterMovementTypes.h"
+
+/**
+ * Fixed size ring of the moves the server hasn't acknowledged yet, oldest first.
+ * Acknowledging only moves the head, nothing is copied or allocated.
+ */
+class FShooterMoveBuffer
+{
+public:
+	static constexpr int32 Capacity = 128;
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity has to be a power of two");
+
+	FORCEINLINE int32 Num() const { return Count; }
+	FORCEINLINE bool IsEmpty() const { return Count == 0; }
+	FORCEINLINE const FShooterMove& operator[](const int32 Index) const { return Moves[(Head + Index) & (Capacity - 1)]; }
+	FORCEINLINE FShooterMove& Last() { return Moves[(Head + Count - 1) & (Capacity - 1)]; }
+
+	void Add(const FShooterMove& Move)
+	{
+		if(Count == Capacity)
+		{
+			//the server is hopelessly behind, the oldest move is the one we can best afford to lose
+			Head = (Head + 1) & (Capacity - 1);
+			Count--;
+		}
+		Moves[(Head + Count) & (Capacity - 1)] = Move;
+		Count++;
+	}
+
+	//drops every move up to and including AcknowledgedSequence
+	void Acknowledge(const uint16 AcknowledgedSequence)
+	{
+		while(Count > 0 && !IsSequenceNewer(Moves[Head].Sequence, AcknowledgedSequence))
+		{
+			Head = (Head + 1) & (Capacity - 1);
+			Count--;
+		}
+	}
+
+	void Reset()
+	{
+		Head = 0;
+		Count = 0;
+	}
+
+	//wrap around safe, true if A was sent after B
+	static FORCEINLINE bool IsSequenceNewer(const uint16 A, const uint16 B)
+	{
+		return static_cast<int16>(A - B) > 0;
+	}
+
+private:
+	TStaticArray<FShooterMove, Capacity> Moves;
+	int32 Head = 0;
+	int32 Count = 0;
+};
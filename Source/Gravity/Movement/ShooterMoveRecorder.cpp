@@ -0,0 +1,288 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterMoveRecorder.h"
+
+#include "EngineUtils.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/OutputDeviceFile.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Gravity/Gravity.h"
+#include "Gravity/Movement/ShooterWorldQuery.h"
+
+static TAutoConsoleVariable<bool> CVarRecordMoves(
+	TEXT("Gravity.RecordMoves"),
+	false,
+	TEXT("Record every move the server applies to Saved/MoveStreams, one file per pawn."));
+
+namespace ShooterMoveStream
+{
+	constexpr uint32 Magic = 0x53564D47;
+	//bump whenever a serialized field or FShooterMovementSettings changes
+	constexpr uint32 Version = 2;
+
+	using FActorMap = TMap<FString, AActor*>;
+
+	FString GetStreamDir()
+	{
+		return FPaths::ProjectSavedDir() / TEXT("MoveStreams");
+	}
+
+	void SerializeActor(FArchive& Ar, AActor*& Actor, const FActorMap* Actors)
+	{
+		FString ActorName = Ar.IsSaving() ? GetNameSafe(Actor) : FString();
+		Ar << ActorName;
+		if(Ar.IsLoading())
+		{
+			AActor* const* FoundActor = Actors ? Actors->Find(ActorName) : nullptr;
+			Actor = FoundActor ? *FoundActor : nullptr;
+		}
+	}
+
+	void SerializeMove(FArchive& Ar, FShooterMove& Move, const FActorMap* Actors)
+	{
+		Ar << static_cast<FVector&>(Move.MovementVector);
+		Ar << Move.PitchInput << Move.YawInput;
+		Ar << Move.ShooterRotationAfterMovement;
+		Ar << Move.LastPitchRotation << Move.LastYawRotation << Move.SpringArmPitch;
+		Ar << Move.bJumped << Move.bMagnetizedPressed << Move.bBoost;
+		Ar << static_cast<FVector&>(Move.BoostDirection);
+		Ar << Move.FloorContact;
+		SerializeActor(Ar, Move.ContactFloor, Actors);
+		Ar << Move.Sequence << Move.RepeatCount;
+	}
+
+	void SerializeFloorHit(FArchive& Ar, FHitResult& Hit, AActor* Floor)
+	{
+		//only what the simulation reads back, the rest is rebuilt by the next full floor query
+		bool bBlockingHit = Hit.bBlockingHit;
+		bool bStartPenetrating = Hit.bStartPenetrating;
+		Ar << bBlockingHit << bStartPenetrating;
+		Ar << Hit.Time << Hit.Distance;
+		Ar << static_cast<FVector&>(Hit.Location) << static_cast<FVector&>(Hit.ImpactPoint);
+		Ar << static_cast<FVector&>(Hit.Normal) << static_cast<FVector&>(Hit.ImpactNormal);
+		if(Ar.IsLoading())
+		{
+			Hit.bBlockingHit = bBlockingHit;
+			Hit.bStartPenetrating = bStartPenetrating;
+			Hit.HitObjectHandle = FActorInstanceHandle(Floor);
+			Hit.Component = Floor ? Cast<UPrimitiveComponent>(Floor->GetRootComponent()) : nullptr;
+		}
+	}
+
+	void SerializeStatus(FArchive& Ar, FShooterStatus& Status, const FActorMap* Actors)
+	{
+		Ar << static_cast<FVector&>(Status.ShooterLocation);
+		Ar << Status.ShooterRotation;
+		Ar << Status.SpringArmPitch << Status.SpringArmYaw;
+		Ar << Status.LastPitchRotation << Status.LastYawRotation;
+		Ar << Status.bMagnetized << Status.BoostCount << Status.BoostRechargeTimeRemaining;
+		Ar << static_cast<FVector&>(Status.CurrentVelocity);
+		Ar << static_cast<FVector&>(Status.JumpForce);
+		Ar << static_cast<FVector&>(Status.SphereLastVelocity);
+		SerializeMove(Ar, Status.LastMove, Actors);
+		Ar << Status.ShooterFloorStatus << Status.ShooterSpin;
+		Ar << Status.ClosestDistanceToFloor;
+		SerializeActor(Ar, Status.ClosestFloor, Actors);
+		SerializeActor(Ar, Status.CurrentFloor, Actors);
+		SerializeFloorHit(Ar, Status.FloorHitResult, Status.ClosestFloor);
+		Ar << static_cast<FVector&>(Status.CurrentGravity);
+		Ar << static_cast<FVector&>(Status.SphereLocation);
+		Ar << Status.ServerTime;
+		Ar << Status.FloorCacheLocation << Status.FloorCacheSteps;
+	}
+
+	bool SerializeHeader(FArchive& Ar, FShooterMoveStreamHeader& Header, const FActorMap* Actors)
+	{
+		uint32 StreamMagic = Magic;
+		uint32 StreamVersion = Version;
+		int32 SettingsSize = sizeof(FShooterMovementSettings);
+		Ar << StreamMagic << StreamVersion << SettingsSize;
+		if(StreamMagic != Magic || StreamVersion != Version || SettingsSize != sizeof(FShooterMovementSettings))
+		{
+			return false;
+		}
+		Ar << Header.PawnName << Header.GravityLevelSphereName;
+		//the settings are plain floats, a size or version change is already rejected above
+		Ar.Serialize(&Header.Settings, SettingsSize);
+		Ar << Header.FixedTimeStep;
+		SerializeStatus(Ar, Header.InitialStatus, Actors);
+		return !Ar.IsError();
+	}
+
+	void PlayMoves(const TArray<FString>& Args, UWorld* World)
+	{
+		if(Args.Num() < 1 || World == nullptr)
+		{
+			UE_LOG(LogGravity, Warning, TEXT("Gravity.PlayMoves <File> [Iterations]"));
+			return;
+		}
+		FString Filename = Args[0];
+		if(FPaths::IsRelative(Filename) && !FPaths::FileExists(Filename))
+		{
+			Filename = GetStreamDir() / Filename;
+		}
+		const int32 Iterations = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : 1;
+		FShooterMoveStreamPlayer Player;
+		if(!Player.Load(Filename, World))
+		{
+			UE_LOG(LogGravity, Warning, TEXT("Gravity.PlayMoves couldn't load %s"), *Filename);
+			return;
+		}
+		const FShooterMoveStreamResult Result = Player.Run(Iterations);
+		UE_LOG(LogGravity, Display, TEXT("%s: %d moves x %d, %.1f ns/step, final status hash %08x"),
+			*FPaths::GetCleanFilename(Filename), Player.NumMoves(), Iterations, Result.NanosecondsPerStep, Result.FinalStatusHash);
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs PlayMovesCommand(
+	TEXT("Gravity.PlayMoves"),
+	TEXT("Gravity.PlayMoves <File> [Iterations], steps a recorded move stream and logs ns per step and the final status hash."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&ShooterMoveStream::PlayMoves));
+
+FShooterMoveRecorder::~FShooterMoveRecorder()
+{
+	End();
+}
+
+bool FShooterMoveRecorder::WantsRecording()
+{
+	return CVarRecordMoves.GetValueOnGameThread();
+}
+
+bool FShooterMoveRecorder::Begin(const FShooterMoveStreamHeader& Header)
+{
+	End();
+	const FString StreamDir = ShooterMoveStream::GetStreamDir();
+	IFileManager::Get().MakeDirectory(*StreamDir, true);
+	const FString Filename = StreamDir / FString::Printf(TEXT("%s_%s.gmoves"), *Header.PawnName, *FDateTime::Now().ToString());
+	FileWriter.Reset(IFileManager::Get().CreateFileWriter(*Filename));
+	if(!FileWriter.IsValid())
+	{
+		UE_LOG(LogGravity, Warning, TEXT("Couldn't open %s for recording moves"), *Filename);
+		return false;
+	}
+	AsyncWriter = MakeUnique<FAsyncWriter>(*FileWriter);
+	NumRecordedMoves = 0;
+
+	FShooterMoveStreamHeader HeaderToWrite = Header;
+	RecordBuffer.Reset();
+	FMemoryWriter Writer(RecordBuffer);
+	ShooterMoveStream::SerializeHeader(Writer, HeaderToWrite, nullptr);
+	AsyncWriter->Serialize(RecordBuffer.GetData(), RecordBuffer.Num());
+	UE_LOG(LogGravity, Log, TEXT("Recording moves to %s"), *Filename);
+	return true;
+}
+
+void FShooterMoveRecorder::RecordMove(const FShooterMove& Move)
+{
+	if(!IsRecording())
+	{
+		return;
+	}
+	FShooterMove MoveToWrite = Move;
+	RecordBuffer.Reset();
+	FMemoryWriter Writer(RecordBuffer);
+	ShooterMoveStream::SerializeMove(Writer, MoveToWrite, nullptr);
+	AsyncWriter->Serialize(RecordBuffer.GetData(), RecordBuffer.Num());
+	NumRecordedMoves++;
+}
+
+void FShooterMoveRecorder::End()
+{
+	if(!IsRecording())
+	{
+		return;
+	}
+	//the async writer flushes what it still holds before the file closes under it
+	AsyncWriter.Reset();
+	FileWriter.Reset();
+	UE_LOG(LogGravity, Log, TEXT("Recorded %d moves"), NumRecordedMoves);
+}
+
+bool FShooterMoveStreamPlayer::Load(const FString& Filename, UWorld* InWorld)
+{
+	TArray<uint8> StreamData;
+	if(InWorld == nullptr || !FFileHelper::LoadFileToArray(StreamData, *Filename))
+	{
+		return false;
+	}
+	ShooterMoveStream::FActorMap Actors;
+	for(TActorIterator<AActor> ActorIt(InWorld); ActorIt; ++ActorIt)
+	{
+		Actors.Add(ActorIt->GetName(), *ActorIt);
+	}
+
+	FMemoryReader Reader(StreamData);
+	if(!ShooterMoveStream::SerializeHeader(Reader, Header, &Actors))
+	{
+		return false;
+	}
+	Moves.Reset();
+	while(!Reader.AtEnd() && !Reader.IsError())
+	{
+		FShooterMove Move;
+		ShooterMoveStream::SerializeMove(Reader, Move, &Actors);
+		if(!Reader.IsError())
+		{
+			Moves.Add(Move);
+		}
+	}
+	World = InWorld;
+	AActor* const* LevelSphere = Actors.Find(Header.GravityLevelSphereName);
+	GravityLevelSphere = LevelSphere ? *LevelSphere : nullptr;
+	return true;
+}
+
+FShooterMoveStreamResult FShooterMoveStreamPlayer::Run(const int32 Iterations) const
+{
+	FShooterMoveStreamResult Result;
+	const FShooterMovementSimulation Simulation(Header.Settings);
+	const FShooterWorldQuery WorldQuery(World, GravityLevelSphere, Header.Settings.GravityDistanceRadius, Header.Settings.SphereTraceRadius);
+	FShooterStatus Status;
+	uint64 StepCycles = 0;
+	for(int32 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		Status = Header.InitialStatus;
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		//the server records every step it applies, repeats are already expanded
+		for(const FShooterMove& Move : Moves)
+		{
+			Status = Simulation.StepClientMove(Move, Status, WorldQuery, Header.FixedTimeStep);
+		}
+		StepCycles += FPlatformTime::Cycles64() - StartCycles;
+		Result.Steps += Moves.Num();
+	}
+	Result.NanosecondsPerStep = Result.Steps > 0 ? FPlatformTime::ToSeconds64(StepCycles) * 1.0e9 / Result.Steps : 0.0;
+	Result.FinalStatusHash = HashStatus(Status);
+	return Result;
+}
+
+uint32 FShooterMoveStreamPlayer::HashStatus(const FShooterStatus& Status)
+{
+	uint32 Hash = 0;
+	auto HashValue = [&Hash](const auto& Value)
+	{
+		Hash = FCrc::MemCrc32(&Value, sizeof(Value), Hash);
+	};
+	HashValue(static_cast<const FVector&>(Status.ShooterLocation));
+	HashValue(Status.ShooterRotation);
+	HashValue(static_cast<const FVector&>(Status.CurrentVelocity));
+	HashValue(static_cast<const FVector&>(Status.JumpForce));
+	HashValue(static_cast<const FVector&>(Status.SphereLastVelocity));
+	HashValue(static_cast<const FVector&>(Status.CurrentGravity));
+	HashValue(Status.SpringArmPitch);
+	HashValue(Status.SpringArmYaw);
+	HashValue(Status.BoostCount);
+	HashValue(Status.BoostRechargeTimeRemaining);
+	HashValue(Status.ShooterFloorStatus);
+	HashValue(Status.ShooterSpin);
+	//names rather than pointers so the hash holds across runs
+	Hash = FCrc::StrCrc32(*GetNameSafe(Status.ClosestFloor), Hash);
+	Hash = FCrc::StrCrc32(*GetNameSafe(Status.CurrentFloor), Hash);
+	return Hash;
+}
@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Gravity/GravityTypes/ShooterMovementTypes.h"
+#include "Gravity/Movement/ShooterMovementSimulation.h"
+
+class FAsyncWriter;
+
+/**
+ * Everything a recorded move stream starts from, written once at the top of the file.
+ * Actors are stored by name and found again in whatever world the stream is played in.
+ */
+struct FShooterMoveStreamHeader
+{
+	FString PawnName;
+	FString GravityLevelSphereName;
+	FShooterMovementSettings Settings;
+	float FixedTimeStep = 1.f/60.f;
+	FShooterStatus InitialStatus;
+};
+
+/**
+ * Writes the moves a pawn applies on the server to Saved/MoveStreams, one file per pawn per recording.
+ * Each move is packed on the game thread and handed to an async writer, the file is only touched off thread.
+ * Turned on and off with Gravity.RecordMoves.
+ */
+class GRAVITY_API FShooterMoveRecorder
+{
+public:
+	FShooterMoveRecorder() = default;
+	~FShooterMoveRecorder();
+	FShooterMoveRecorder(const FShooterMoveRecorder&) = delete;
+	FShooterMoveRecorder& operator=(const FShooterMoveRecorder&) = delete;
+
+	static bool WantsRecording();
+
+	bool Begin(const FShooterMoveStreamHeader& Header);
+	void RecordMove(const FShooterMove& Move);
+	void End();
+
+	FORCEINLINE bool IsRecording() const { return AsyncWriter.IsValid(); }
+
+private:
+	TUniquePtr<FArchive> FileWriter;
+	TUniquePtr<FAsyncWriter> AsyncWriter;
+	//reused for every record so packing a move doesn't allocate
+	TArray<uint8> RecordBuffer;
+	int32 NumRecordedMoves = 0;
+};
+
+struct FShooterMoveStreamResult
+{
+	int32 Steps = 0;
+	double NanosecondsPerStep = 0.0;
+	//the same stream, build and level always hash the same, a change means the simulation changed
+	uint32 FinalStatusHash = 0;
+};
+
+/**
+ * Feeds a recorded stream back through FShooterMovementSimulation::StepClientMove against the given world.
+ * Nothing is rendered or replicated, so this runs the same under -nullrhi:
+ * -nullrhi -ExecCmds="Gravity.PlayMoves <File> <Iterations>"
+ */
+class GRAVITY_API FShooterMoveStreamPlayer
+{
+public:
+	bool Load(const FString& Filename, UWorld* InWorld);
+	FShooterMoveStreamResult Run(int32 Iterations = 1) const;
+
+	FORCEINLINE const FShooterMoveStreamHeader& GetHeader() const { return Header; }
+	FORCEINLINE int32 NumMoves() const { return Moves.Num(); }
+
+	static uint32 HashStatus(const FShooterStatus& Status);
+
+private:
+	const UWorld* World = nullptr;
+	const AActor* GravityLevelSphere = nullptr;
+	FShooterMoveStreamHeader Header;
+	TArray<FShooterMove> Moves;
+};
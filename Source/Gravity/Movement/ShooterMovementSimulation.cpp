@@ -0,0 +1,520 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterMovementSimulation.h"
+
+#include "ShooterWorldQuery.h"
+#include "Gravity/GravityStats.h"
+
+#include <atomic>
+
+namespace ShooterMovementSimulation
+{
+	//hit rate is published every this many lookups, steps also run from the bots' ParallelFor so the counts are shared
+	constexpr uint32 FloorCacheStatWindow = 256;
+	std::atomic<uint32> FloorCacheHits{0};
+	std::atomic<uint32> FloorCacheLookups{0};
+
+	void RecordFloorCacheLookup(const bool bHit)
+	{
+		if(bHit)
+		{
+			FloorCacheHits.fetch_add(1, std::memory_order_relaxed);
+		}
+		//only the lookup that fills the window publishes it, a few from other threads may land in the next one
+		if(FloorCacheLookups.fetch_add(1, std::memory_order_relaxed) + 1 == FloorCacheStatWindow)
+		{
+			const uint32 WindowHits = FloorCacheHits.exchange(0, std::memory_order_relaxed);
+			FloorCacheLookups.fetch_sub(FloorCacheStatWindow, std::memory_order_relaxed);
+			SET_FLOAT_STAT(STAT_GravityFloorCacheHitRate, 100.f * FMath::Min(WindowHits, FloorCacheStatWindow) / FloorCacheStatWindow);
+		}
+	}
+}
+
+FShooterMovementSimulation::FShooterMovementSimulation(const FShooterMovementSettings& InSettings)
+	: Settings(InSettings)
+{
+}
+
+FShooterStatus FShooterMovementSimulation::StepMove(const FShooterMove& Move, const FShooterStatus& InStatus, const IShooterWorldQuery& WorldQuery, const float DeltaTime) const
+{
+	FShooterStatus NextStatus = InStatus;
+	SimulateMovement(Move, NextStatus, WorldQuery, DeltaTime);
+	SimulateLook(Move, NextStatus, DeltaTime);
+	return NextStatus;
+}
+
+FShooterStatus FShooterMovementSimulation::StepClientMove(const FShooterMove& Move, const FShooterStatus& InStatus, const IShooterWorldQuery& WorldQuery, const float DeltaTime) const
+{
+	FShooterStatus ContactStatus = InStatus;
+	const bool bLandedThisMove = ContactStatus.ShooterFloorStatus == EShooterFloorStatus::NoFloorContact && Move.FloorContact != EShooterFloorStatus::NoFloorContact;
+	if(CanLandOn(Move.FloorContact, Move.ContactFloor, ContactStatus))
+	{
+		ApplyFloorContact(Move.FloorContact, Move.ContactFloor, ContactStatus);
+	}
+	FShooterStatus NextStatus = StepMove(Move, ContactStatus, WorldQuery, DeltaTime);
+	if(bLandedThisMove && ContactStatus.ShooterFloorStatus != EShooterFloorStatus::NoFloorContact)
+	{
+		//the client snaps its rotation to the impact normal when it lands, we don't have the hit so take its rotation, as far as the tolerance allows
+		const FQuat OwnRotation = NextStatus.ShooterRotation.Quaternion();
+		const FQuat ClaimedRotation = Move.ShooterRotationAfterMovement.Quaternion();
+		const float Angle = FMath::RadiansToDegrees(OwnRotation.AngularDistance(ClaimedRotation));
+		NextStatus.ShooterRotation = Angle <= Settings.LandingRotationTolerance ?
+			Move.ShooterRotationAfterMovement :
+			FQuat::Slerp(OwnRotation, ClaimedRotation, Settings.LandingRotationTolerance / Angle).Rotator();
+	}
+	return NextStatus;
+}
+
+void FShooterMovementSimulation::SimulateMovement(const FShooterMove& Move, FShooterStatus& OutStatus, const IShooterWorldQuery& WorldQuery, const float DeltaTime) const
+{
+	FTransform NewActorTransform;
+	NewActorTransform.SetLocation(OutStatus.ShooterLocation);
+	NewActorTransform.SetRotation(OutStatus.ShooterRotation.Quaternion());
+
+	OutStatus.CurrentVelocity = Movement_Internal(Move.MovementVector, OutStatus, DeltaTime);
+	Magnetize_Internal(Move.bMagnetizedPressed, OutStatus);
+	BoostRecharge_Internal(OutStatus, DeltaTime);
+	Boost_Internal(Move.BoostDirection, Move.bBoost, OutStatus);
+	if(OutStatus.ShooterFloorStatus != EShooterFloorStatus::BaseFloorContact)
+	{
+		NewActorTransform = PerformGravity(OutStatus, WorldQuery, DeltaTime);
+	}
+	NewActorTransform.AddToTranslation(Jump_Internal(Move.bJumped, OutStatus));
+
+	OutStatus.ShooterLocation = NewActorTransform.GetLocation();
+	OutStatus.ShooterRotation = NewActorTransform.Rotator();
+}
+
+void FShooterMovementSimulation::SimulateLook(const FShooterMove& Move, FShooterStatus& OutStatus, const float DeltaTime) const
+{
+	PitchLook_Internal(Move.PitchInput, OutStatus, DeltaTime);
+	const FQuat SpinRotation = AddShooterSpin_Internal(Move.PitchInput, OutStatus, DeltaTime).Quaternion();
+	const FQuat YawRotation = YawLook_Internal(Move.YawInput, OutStatus, DeltaTime).Quaternion();
+	//same order the actor used to apply its local rotations in
+	OutStatus.ShooterRotation = (OutStatus.ShooterRotation.Quaternion() * SpinRotation * YawRotation).Rotator();
+	OutStatus.ShooterLocation += OutStatus.CurrentVelocity;
+}
+
+FVector FShooterMovementSimulation::Movement_Internal(const FVector ActionValue, FShooterStatus& OutStatus, const float DeltaTime) const
+{
+	const FVector InputMovementVector = TotalMovementInput(ActionValue, OutStatus, DeltaTime);
+	return CalculateMovementVelocity(InputMovementVector,OutStatus, DeltaTime);
+}
+
+FVector FShooterMovementSimulation::TotalMovementInput(const FVector ActionValue, const FShooterStatus& InStatus, const float DeltaTime) const
+{
+	const FVector ForwardVector = InStatus.ShooterRotation.Quaternion().GetAxisX();
+	const FVector RightVector = InStatus.ShooterRotation.Quaternion().GetAxisY();
+	const FVector UpVector = InStatus.ShooterRotation.Quaternion().GetAxisZ();
+
+	if(InStatus.ShooterFloorStatus != EShooterFloorStatus::NoFloorContact) //if contacted with a floor
+	{
+
+		if(ActionValue.X > 0.f && ActionValue.Y == 0.f)
+		{
+			//if just going forward, go GroundForwardSpeed
+			return ForwardVector * ActionValue.X * Settings.GroundForwardSpeed * DeltaTime;
+		}
+		if(ActionValue.X > 0.f && ActionValue.Y != 0.f)
+		{
+			//if going forward and any lateral input, go a constant ForwardLateralSpeed
+			return RightVector * ActionValue.Y * (Settings.GroundForwardLateralSpeed/2.f) * DeltaTime + ForwardVector * ActionValue.X * (Settings.GroundForwardLateralSpeed/2.f) * DeltaTime;
+		}
+		if(ActionValue.X == 0.f && ActionValue.Y != 0.f)
+		{
+			//if not going forward and any lateral input, go a constant GroundLateralSpeed
+			return RightVector * ActionValue.Y * Settings.GroundLateralSpeed * DeltaTime;
+		}
+		if(ActionValue.X < 0.f)
+		{
+			//if going backwards at all, go the GroundBackwardSpeed
+			return RightVector * ActionValue.Y * (Settings.GroundBackwardSpeed/2.f) * DeltaTime + ForwardVector * ActionValue.X * (Settings.GroundBackwardSpeed/2.f) * DeltaTime;
+		}
+
+	}
+	else //if not contacted with a floor
+	{
+		return (ForwardVector * ActionValue.X + RightVector * ActionValue.Y + UpVector * ActionValue.Z) * DeltaTime;
+	}
+	return FVector::ZeroVector;
+}
+
+FVector FShooterMovementSimulation::CalculateMovementVelocity(const FVector InMovementInput, FShooterStatus& OutStatus, const float DeltaTime) const
+{
+	if(OutStatus.ShooterFloorStatus == EShooterFloorStatus::BaseFloorContact && OutStatus.bMagnetized) //if walking on a flat floor and magnetized
+	{
+		if(InMovementInput.Size() == 0.f)
+		{
+			return FMath::VInterpTo(OutStatus.CurrentVelocity, FVector::ZeroVector, DeltaTime, Settings.StoppingSpeed);
+		}
+		return  FMath::VInterpTo(OutStatus.CurrentVelocity, InMovementInput, DeltaTime, Settings.AccelerationSpeed);
+	}
+	if(OutStatus.ShooterFloorStatus == EShooterFloorStatus::SphereFloorContact && OutStatus.bMagnetized) //if walking on a sphere and magnetized
+	{
+		if(InMovementInput.Size() == 0.f)
+		{
+			OutStatus.SphereLastVelocity = FMath::VInterpTo(OutStatus.SphereLastVelocity, FVector::ZeroVector, DeltaTime, Settings.StoppingSpeed);
+			const FMatrix InputRotation = FRotationMatrix::MakeFromXZ(OutStatus.SphereLastVelocity, OutStatus.ShooterRotation.Quaternion().GetAxisZ());
+			const FVector SphereToActor = OutStatus.ShooterLocation - OutStatus.SphereLocation;
+			const FVector NewPosition = SphereToActor.RotateAngleAxis(OutStatus.SphereLastVelocity.Size(), InputRotation.GetUnitAxis(EAxis::Y));
+			return NewPosition - SphereToActor;
+		}
+		const FVector AdjustedControlInputVector = InMovementInput * Settings.SphereFloorMovementPercent;
+		OutStatus.SphereLastVelocity = FMath::VInterpTo(OutStatus.SphereLastVelocity, AdjustedControlInputVector, DeltaTime, Settings.AccelerationSpeed);
+		const FMatrix InputRotation = FRotationMatrix::MakeFromXZ(OutStatus.SphereLastVelocity, OutStatus.ShooterRotation.Quaternion().GetAxisZ());
+		const FVector SphereToActor = OutStatus.ShooterLocation - OutStatus.SphereLocation;
+		const FVector NewPosition = SphereToActor.RotateAngleAxis(OutStatus.SphereLastVelocity.Size(), InputRotation.GetUnitAxis(EAxis::Y));
+		return NewPosition - SphereToActor;
+	}
+	if(OutStatus.ShooterFloorStatus == EShooterFloorStatus::SphereLevelContact && OutStatus.bMagnetized) //if walking in a sphere and magnetized OR jumping on level sphere
+	{
+		if(InMovementInput.Size() == 0.f)
+		{
+			OutStatus.SphereLastVelocity = FMath::VInterpTo(OutStatus.SphereLastVelocity, FVector::ZeroVector, DeltaTime, Settings.StoppingSpeed);
+			const FMatrix InputRotation = FRotationMatrix::MakeFromXZ(OutStatus.SphereLastVelocity, OutStatus.ShooterRotation.Quaternion().GetAxisZ());
+			const FVector SphereToActor = OutStatus.ShooterLocation - OutStatus.SphereLocation;
+			const FVector NewPosition = SphereToActor.RotateAngleAxis(OutStatus.SphereLastVelocity.Size(), InputRotation.GetUnitAxis(EAxis::Y));
+			return NewPosition - SphereToActor;
+		}
+		const FVector AdjustedControlInputVector = -InMovementInput * Settings.LevelSphereMovementPercent;
+		OutStatus.SphereLastVelocity = FMath::VInterpTo(OutStatus.SphereLastVelocity, AdjustedControlInputVector, DeltaTime, Settings.AccelerationSpeed);
+		const FMatrix InputRotation = FRotationMatrix::MakeFromXZ(OutStatus.SphereLastVelocity, OutStatus.ShooterRotation.Quaternion().GetAxisZ());
+		const FVector SphereToActor = OutStatus.ShooterLocation - OutStatus.SphereLocation;
+		const FVector NewPosition = SphereToActor.RotateAngleAxis(OutStatus.SphereLastVelocity.Size(), InputRotation.GetUnitAxis(EAxis::Y));
+		return NewPosition - SphereToActor;
+	}
+	return OutStatus.CurrentVelocity + InMovementInput * Settings.AirSpeed;
+}
+
+FRotator FShooterMovementSimulation::PitchLook_Internal(const float PitchInput, FShooterStatus& OutStatus, const float DeltaTime) const
+{
+	OutStatus.SpringArmPitch = FMath::Clamp(OutStatus.SpringArmPitch + (PitchInput * DeltaTime * Settings.SpringArmPitchSpeed), Settings.SpringArmPitchMin, Settings.SpringArmPitchMax);
+	if(OutStatus.SpringArmPitch > (Settings.SpringArmPitchMax - 1.5f) && OutStatus.ShooterFloorStatus == EShooterFloorStatus::NoFloorContact)
+	{
+		OutStatus.ShooterSpin = EShooterSpin::BackFlip;
+	}
+	else if(OutStatus.SpringArmPitch < (Settings.SpringArmPitchMin + 1.5f) && OutStatus.ShooterFloorStatus == EShooterFloorStatus::NoFloorContact)
+	{
+		OutStatus.ShooterSpin = EShooterSpin::FrontFlip;
+	}
+	else
+	{
+		OutStatus.ShooterSpin = EShooterSpin::NoFlip;
+	}
+	return FRotator(OutStatus.SpringArmPitch, OutStatus.SpringArmYaw, 0.f);
+}
+
+FRotator FShooterMovementSimulation::AddShooterSpin_Internal(const float PitchInput, const FShooterStatus& InStatus, const float DeltaTime) const
+{
+	//We are not contacted to a floor
+	if(InStatus.ShooterFloorStatus == EShooterFloorStatus::NoFloorContact)
+	{
+		switch (InStatus.ShooterSpin)
+		{
+		case EShooterSpin::BackFlip:
+			if(PitchInput <= 0.f)
+			{
+				return FRotator(InStatus.LastPitchRotation, 0.f, 0.f);
+			}
+			return FRotator(FMath::Clamp(InStatus.LastPitchRotation + PitchInput * Settings.AirPitchSpeed * DeltaTime, -Settings.MaxPitchSpeed, Settings.MaxPitchSpeed), 0.f, 0.f);
+		case EShooterSpin::FrontFlip:
+			if(PitchInput >= 0.f)
+			{
+				return FRotator(InStatus.LastPitchRotation, 0.f, 0.f);
+			}
+			return FRotator(FMath::Clamp(InStatus.LastPitchRotation - PitchInput * -Settings.AirPitchSpeed * DeltaTime, -Settings.MaxPitchSpeed, Settings.MaxPitchSpeed), 0.f, 0.f);
+		case EShooterSpin::NoFlip:
+			return FRotator(InStatus.LastPitchRotation, 0.f, 0.f);
+		default:
+			return FRotator(InStatus.LastPitchRotation, 0.f, 0.f);
+		}
+	}
+	return FRotator(InStatus.LastPitchRotation, 0.f, 0.f);
+}
+
+FRotator FShooterMovementSimulation::YawLook_Internal(const float YawInput, FShooterStatus& OutStatus, const float DeltaTime) const
+{
+	//We are contacted to a floor
+	if(OutStatus.ShooterFloorStatus != EShooterFloorStatus::NoFloorContact)
+	{
+		return FRotator(0.f, YawInput, 0.f);
+	}
+	//We are not contacted to a floor
+	if(YawInput == 0.f)
+	{
+		return FRotator(0.f, OutStatus.LastYawRotation, 0.f);
+	}
+	const float NewYawRotation = FMath::Clamp(OutStatus.LastYawRotation + YawInput * Settings.AirRotationSpeed * DeltaTime, -Settings.AirRotationMaxSpeed, Settings.AirRotationMaxSpeed);
+	return FRotator(0.f, OutStatus.LastYawRotation = NewYawRotation, 0.f);
+}
+
+FVector FShooterMovementSimulation::Jump_Internal(const bool bJumpWasPressed, FShooterStatus& OutStatus) const
+{
+	if(bJumpWasPressed)
+	{
+		if(OutStatus.ShooterFloorStatus != EShooterFloorStatus::NoFloorContact && OutStatus.bMagnetized) //if we are in contact with a floor
+		{
+			OutStatus.JumpForce = OutStatus.ShooterRotation.Quaternion().GetAxisZ() * Settings.JumpVelocity + OutStatus.CurrentVelocity;
+			OutStatus.CurrentVelocity = FVector::ZeroVector;
+			return OutStatus.JumpForce;
+		}
+	}
+	return OutStatus.JumpForce;
+}
+
+void FShooterMovementSimulation::Magnetize_Internal(const bool bMagnetizedFromMove, FShooterStatus& OutStatus) const
+{
+	if(bMagnetizedFromMove)
+	{
+		OutStatus.bMagnetized = !OutStatus.bMagnetized;
+	}
+	if(!OutStatus.bMagnetized)
+	{
+		OutStatus.ShooterFloorStatus = SetFloorStatus(EShooterFloorStatus::NoFloorContact, OutStatus);
+	}
+}
+
+void FShooterMovementSimulation::Boost_Internal(const FVector BoostVector, const bool bBoostWasPressed, FShooterStatus& OutStatus) const
+{
+	if(bBoostWasPressed)
+	{
+		if(OutStatus.BoostCount > 0)
+		{
+			FTransform InActorTransform;
+			InActorTransform.SetLocation(OutStatus.ShooterLocation);
+			InActorTransform.SetRotation(OutStatus.ShooterRotation.Quaternion());
+			OutStatus.BoostCount --;
+			if(OutStatus.ShooterFloorStatus == EShooterFloorStatus::NoFloorContact)
+			{
+				const FVector WorldBoostVector = InActorTransform.TransformVectorNoScale(BoostVector);
+				OutStatus.CurrentVelocity = WorldBoostVector * Settings.NonContactedBoostSpeed + OutStatus.CurrentVelocity /= Settings.BoostLastVelocityReduction;
+			}
+			else
+			{
+				ContactedBoostForce(BoostVector, OutStatus);
+			}
+			OutStatus.BoostRechargeTimeRemaining = Settings.BoostRechargeRate;
+		}
+	}
+}
+
+void FShooterMovementSimulation::BoostRecharge_Internal(FShooterStatus& OutStatus, const float DeltaTime) const
+{
+	//replaces the old world timer so a recharge plays back the same way on every machine
+	if(OutStatus.BoostRechargeTimeRemaining > 0.f)
+	{
+		OutStatus.BoostRechargeTimeRemaining -= DeltaTime;
+		if(OutStatus.BoostRechargeTimeRemaining <= 0.f)
+		{
+			OutStatus.BoostCount++;
+			OutStatus.BoostRechargeTimeRemaining = OutStatus.BoostCount < Settings.MaxBoosts ? Settings.BoostRechargeRate : 0.f;
+		}
+	}
+}
+
+void FShooterMovementSimulation::ContactedBoostForce(const FVector BoostVector, FShooterStatus& OutStatus) const
+{
+	FTransform InActorTransform;
+	InActorTransform.SetLocation(OutStatus.ShooterLocation);
+	InActorTransform.SetRotation(OutStatus.ShooterRotation.Quaternion());
+	const FVector WorldBoostVector = Settings.ContactedBoostSpeed * InActorTransform.TransformVectorNoScale(BoostVector);
+	if(OutStatus.ShooterFloorStatus == EShooterFloorStatus::BaseFloorContact)
+	{
+		OutStatus.CurrentVelocity = WorldBoostVector;
+	}
+	if(OutStatus.ShooterFloorStatus == EShooterFloorStatus::SphereFloorContact)
+	{
+		OutStatus.SphereLastVelocity = WorldBoostVector * Settings.SphereFloorMovementPercent;
+	}
+	if(OutStatus.ShooterFloorStatus == EShooterFloorStatus::SphereLevelContact)
+	{
+		OutStatus.SphereLastVelocity = -WorldBoostVector * Settings.LevelSphereMovementPercent;
+	}
+}
+
+FTransform FShooterMovementSimulation::PerformGravity(FShooterStatus& OutStatus, const IShooterWorldQuery& WorldQuery, const float DeltaTime) const
+{
+	FTransform NewActorTransform;
+	NewActorTransform.SetLocation(OutStatus.ShooterLocation);
+	NewActorTransform.SetRotation(OutStatus.ShooterRotation.Quaternion());
+	if(OutStatus.bMagnetized && OutStatus.ShooterFloorStatus == EShooterFloorStatus::NoFloorContact)
+	{
+		FindClosestFloor(NewActorTransform.GetLocation(), OutStatus, WorldQuery, DeltaTime);
+		if(OutStatus.ClosestFloor != nullptr)
+		{
+			NewActorTransform.SetRotation(OrientToGravity(NewActorTransform.Rotator(), OutStatus, DeltaTime).Quaternion());
+			OutStatus.LastPitchRotation = 0.f;
+			NewActorTransform.SetLocation(GravityForce(NewActorTransform.GetLocation(), OutStatus, DeltaTime));
+		}
+		return NewActorTransform;
+	}
+	if(OutStatus.bMagnetized && OutStatus.ShooterFloorStatus == EShooterFloorStatus::SphereFloorContact)
+	{
+		if(OutStatus.ClosestFloor != nullptr)
+		{
+			OutStatus.SphereLocation = WorldQuery.GetGravitySourceLocation(OutStatus.ClosestFloor);
+		}
+		OutStatus.CurrentGravity = OutStatus.SphereLocation - NewActorTransform.GetLocation();
+		NewActorTransform.SetRotation(OrientToGravity(NewActorTransform.Rotator(), OutStatus, DeltaTime).Quaternion());
+		OutStatus.LastPitchRotation = 0.f;
+		return NewActorTransform;
+	}
+	if(OutStatus.bMagnetized && OutStatus.ShooterFloorStatus == EShooterFloorStatus::SphereLevelContact)
+	{
+		if(OutStatus.ClosestFloor != nullptr)
+		{
+			OutStatus.SphereLocation = WorldQuery.GetGravitySourceLocation(OutStatus.ClosestFloor);
+		}
+		OutStatus.CurrentGravity = NewActorTransform.GetLocation() - OutStatus.SphereLocation;
+		NewActorTransform.SetRotation(OrientToGravity(NewActorTransform.Rotator(), OutStatus, DeltaTime).Quaternion());
+		OutStatus.LastPitchRotation = 0.f;
+		return NewActorTransform;
+	}
+	return NewActorTransform;
+}
+
+void FShooterMovementSimulation::FindClosestFloor(const FVector& ActorLocation, FShooterStatus& OutStatus, const IShooterWorldQuery& WorldQuery, const float DeltaTime) const
+{
+	GRAVITY_SCOPE_CYCLE_COUNTER(STAT_GravityFindClosestFloor);
+	//everything the cache and the hysteresis read is replicated, so prediction, the server and a replay all pick the same floor
+	const bool bCacheHit = OutStatus.ClosestFloor != nullptr &&
+		OutStatus.FloorCacheSteps * DeltaTime < Settings.FloorCacheMaxAge &&
+		FVector::DistSquared(ActorLocation, OutStatus.FloorCacheLocation) < FMath::Square(Settings.FloorCacheMoveThreshold);
+	FShooterFloorQueryResult QueryResult;
+	if(bCacheHit && WorldQuery.FindFloorSurface(ActorLocation, OutStatus.ClosestFloor, QueryResult))
+	{
+		//too little movement for another floor to have overtaken this one, only the cached floor's surface is solved again
+		ShooterMovementSimulation::RecordFloorCacheLookup(true);
+		OutStatus.FloorCacheSteps = FMath::Min<int32>(OutStatus.FloorCacheSteps + 1, MAX_uint8);
+		if(QueryResult.Distance < OutStatus.ClosestDistanceToFloor)
+		{
+			OutStatus.FloorHitResult = QueryResult.FloorHitResult;
+			OutStatus.ClosestDistanceToFloor = QueryResult.Distance;
+			OutStatus.CurrentGravity = OutStatus.FloorHitResult.ImpactPoint - ActorLocation;
+		}
+		return;
+	}
+	ShooterMovementSimulation::RecordFloorCacheLookup(false);
+
+	OutStatus.FloorCacheLocation = ActorLocation;
+	OutStatus.FloorCacheSteps = 0;
+	if(WorldQuery.FindClosestFloor(ActorLocation, OutStatus.ClosestDistanceToFloor, QueryResult))
+	{
+		//hysteresis, so hovering halfway between two floors doesn't flip gravity every query
+		const bool bSwitchesFloor = OutStatus.ClosestFloor != nullptr && QueryResult.Floor != OutStatus.ClosestFloor;
+		FShooterFloorQueryResult CurrentResult;
+		if(bSwitchesFloor && QueryResult.Distance > OutStatus.ClosestDistanceToFloor - Settings.FloorSwitchHysteresis &&
+			WorldQuery.FindFloorSurface(ActorLocation, OutStatus.ClosestFloor, CurrentResult))
+		{
+			//staying on the current floor, but the hit still has to be from where we are now
+			OutStatus.FloorHitResult = CurrentResult.FloorHitResult;
+			OutStatus.ClosestDistanceToFloor = CurrentResult.Distance;
+			OutStatus.CurrentGravity = OutStatus.FloorHitResult.ImpactPoint - ActorLocation;
+			return;
+		}
+		OutStatus.FloorHitResult = QueryResult.FloorHitResult;
+		OutStatus.ClosestDistanceToFloor = QueryResult.Distance;
+		OutStatus.ClosestFloor = QueryResult.Floor;
+		OutStatus.CurrentGravity = OutStatus.FloorHitResult.ImpactPoint - ActorLocation;
+	}
+}
+
+FRotator FShooterMovementSimulation::OrientToGravity(const FRotator InActorRotation, const FShooterStatus& InStatus, const float DeltaTime) const
+{
+	GRAVITY_SCOPE_CYCLE_COUNTER(STAT_GravityOrientToGravity);
+	//If gravity is any other direction then this MakeFromZX should give us the smoothest rotation
+	const FMatrix FeetToGravity = FRotationMatrix::MakeFromZX(-InStatus.CurrentGravity, InActorRotation.Quaternion().GetAxisX());
+	FQuat NewRotation;
+	if(InStatus.ShooterFloorStatus == EShooterFloorStatus::SphereFloorContact || InStatus.ShooterFloorStatus == EShooterFloorStatus::SphereLevelContact)
+	{
+		NewRotation = FQuat::Slerp(InActorRotation.Quaternion(),FeetToGravity.ToQuat(), 1.f);
+	}
+	else
+	{
+		NewRotation = FQuat::Slerp(InActorRotation.Quaternion(),FeetToGravity.ToQuat(), DeltaTime * (Settings.SlerpSpeed/InStatus.ClosestDistanceToFloor));
+	}
+	return NewRotation.Rotator();
+}
+
+FVector FShooterMovementSimulation::GravityForce(const FVector InActorLocation, FShooterStatus& OutStatus, const float DeltaTime) const
+{
+	GRAVITY_SCOPE_CYCLE_COUNTER(STAT_GravityGravityForce);
+	OutStatus.ClosestDistanceToFloor = OutStatus.FloorHitResult.Distance + Settings.SphereTraceRadius;
+	const float DistancePct = FMath::Abs(150 - 100 * (OutStatus.ClosestDistanceToFloor/Settings.GravityDistanceRadius));
+	FVector NewVector;
+	if(OutStatus.FloorHitResult.bBlockingHit && DistancePct == 100.f)
+	{
+		NewVector = FMath::VInterpConstantTo(InActorLocation, FVector(OutStatus.FloorHitResult.ImpactPoint), DeltaTime, Settings.InRangeGravityStrength);
+	}
+	else if(OutStatus.FloorHitResult.bBlockingHit)
+	{
+		NewVector = FMath::VInterpConstantTo(InActorLocation, FVector(OutStatus.FloorHitResult.ImpactPoint), DeltaTime, FMath::Pow(Settings.OutRangeGravityStrength * DistancePct, Settings.GravityForceCurve));
+	}
+	OutStatus.CurrentVelocity = FMath::VInterpTo(OutStatus.CurrentVelocity, FVector::ZeroVector, DeltaTime, Settings.GravityVelocityReduction);
+	OutStatus.SphereLastVelocity = FVector::ZeroVector;
+	return NewVector;
+}
+
+void FShooterMovementSimulation::ApplyFloorContact(const EShooterFloorStatus ContactStatus, AActor* ContactFloor, FShooterStatus& OutStatus) const
+{
+	if(OutStatus.ShooterFloorStatus == ContactStatus)
+	{
+		return;
+	}
+	if(ContactStatus == EShooterFloorStatus::NoFloorContact)
+	{
+		//feet left the floor, that demagnetizes the same way the client's foot box does
+		if(OutStatus.bMagnetized)
+		{
+			Magnetize_Internal(true, OutStatus);
+		}
+		OutStatus.ShooterFloorStatus = SetFloorStatus(EShooterFloorStatus::NoFloorContact, OutStatus);
+		return;
+	}
+	OutStatus.ShooterFloorStatus = SetFloorStatus(ContactStatus, OutStatus);
+	OutStatus.ShooterSpin = EShooterSpin::NoFlip;
+	OutStatus.LastPitchRotation = 0.f;
+	OutStatus.LastYawRotation = 0.f;
+	OutStatus.CurrentVelocity = FVector::ZeroVector;
+	OutStatus.SphereLastVelocity = FVector::ZeroVector;
+	OutStatus.CurrentFloor = ContactFloor;
+}
+
+bool FShooterMovementSimulation::CanLandOn(const EShooterFloorStatus ContactStatus, const AActor* ContactFloor, const FShooterStatus& InStatus) const
+{
+	if(ContactStatus == EShooterFloorStatus::NoFloorContact || ContactStatus == InStatus.ShooterFloorStatus)
+	{
+		//leaving a floor is always taken, staying on one changes nothing
+		return true;
+	}
+	//only a magnetized pawn lands, and only on the floor it's being pulled to
+	return InStatus.bMagnetized &&
+		ContactFloor != nullptr &&
+		ContactFloor == InStatus.ClosestFloor &&
+		InStatus.ClosestDistanceToFloor <= Settings.LandingDistanceTolerance;
+}
+
+EShooterFloorStatus FShooterMovementSimulation::SetFloorStatus(const EShooterFloorStatus StatusToChangeTo, FShooterStatus& StatusToReset)
+{
+	if(StatusToChangeTo == EShooterFloorStatus::NoFloorContact)
+	{
+		ZeroOutGravity(StatusToReset);
+	}
+	return StatusToChangeTo;
+}
+
+void FShooterMovementSimulation::ZeroOutGravity(FShooterStatus& StatusToReset)
+{
+	StatusToReset.ClosestDistanceToFloor = FLT_MAX;
+	StatusToReset.ClosestFloor = nullptr;
+	const FHitResult NewHitResult;
+	StatusToReset.FloorHitResult = NewHitResult;
+	StatusToReset.CurrentGravity = FVector::ZeroVector;
+	StatusToReset.CurrentFloor = nullptr;
+	if(StatusToReset.JumpForce.Size() > 0.f)
+	{
+		StatusToReset.CurrentVelocity = StatusToReset.JumpForce;
+		StatusToReset.JumpForce = FVector::ZeroVector;
+	}
+}
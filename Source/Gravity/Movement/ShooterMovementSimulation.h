@@ -0,0 +1,114 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Gravity/GravityTypes/ShooterMovementTypes.h"
+
+class IShooterWorldQuery;
+
+/**
+ * Tuning values the simulation runs with, filled from the pawn's editable properties.
+ */
+struct FShooterMovementSettings
+{
+	//movement
+	float SphereFloorMovementPercent = 0.025f;
+	float LevelSphereMovementPercent = 0.0075f;
+	float GroundForwardSpeed = 1000.f;
+	float GroundBackwardSpeed = 500.f;
+	float GroundLateralSpeed = 500.f;
+	float GroundForwardLateralSpeed = 750.f;
+	float StoppingSpeed = 3.f;
+	float AccelerationSpeed = 4.f;
+	float AirSpeed = 2.5f;
+
+	//mouse look
+	float SpringArmPitchSpeed = 10.f;
+	float SpringArmPitchMax = 70.f;
+	float SpringArmPitchMin = -75.f;
+	float AirPitchSpeed = 2.f;
+	float MaxPitchSpeed = 5.f;
+	float AirRotationSpeed = 0.25f;
+	float AirRotationMaxSpeed = 2.f;
+
+	//gravity
+	float SphereTraceRadius = 750.f;
+	float GravityDistanceRadius = 2500.f;
+	float SlerpSpeed = 1000.f;
+	float OutRangeGravityStrength = 0.3f;
+	float InRangeGravityStrength = 500.f;
+	float GravityForceCurve = 2.f;
+	float GravityVelocityReduction = 1.15f;
+	//the closest floor is only queried again after moving this far or this long, and another floor has to be this much closer to take over
+	//the cache state is replicated with the status, so the server and replays run it too
+	float FloorCacheMoveThreshold = 50.f;
+	float FloorCacheMaxAge = 0.25f;
+	float FloorSwitchHysteresis = 25.f;
+	//a landing from a move is only taken on the floor we found and this close to it, and its rotation only this many degrees from ours
+	float LandingDistanceTolerance = 300.f;
+	float LandingRotationTolerance = 30.f;
+
+	//jump
+	float JumpVelocity = 10.f;
+
+	//boost
+	float BoostLastVelocityReduction = 1.15f;
+	float NonContactedBoostSpeed = 25.f;
+	float ContactedBoostSpeed = 30.f;
+	float BoostRechargeRate = 5.f;
+	int8 MaxBoosts = 2;
+};
+
+/**
+ * Steps an FShooterStatus forward by one FShooterMove without touching an actor.
+ * Client prediction, server reconciliation and offline runs all go through here so they stay in sync.
+ */
+class GRAVITY_API FShooterMovementSimulation
+{
+public:
+	FShooterMovementSimulation() = default;
+	explicit FShooterMovementSimulation(const FShooterMovementSettings& InSettings);
+
+	FShooterStatus StepMove(const FShooterMove& Move, const FShooterStatus& InStatus, const IShooterWorldQuery& WorldQuery, float DeltaTime) const;
+	//a move received from or replayed for the client, its floor contact lands first and a landing keeps the client's rotation
+	//the landing is checked against our own closest floor first, and the rotation clamped to ours
+	FShooterStatus StepClientMove(const FShooterMove& Move, const FShooterStatus& InStatus, const IShooterWorldQuery& WorldQuery, float DeltaTime) const;
+
+	//movement, magnetize, boost, gravity and jump
+	void SimulateMovement(const FShooterMove& Move, FShooterStatus& OutStatus, const IShooterWorldQuery& WorldQuery, float DeltaTime) const;
+	//spring arm pitch, spin, yaw and applying the velocity
+	void SimulateLook(const FShooterMove& Move, FShooterStatus& OutStatus, float DeltaTime) const;
+
+	FVector Movement_Internal(const FVector ActionValue, FShooterStatus& OutStatus, float DeltaTime) const;
+	void Magnetize_Internal(bool bMagnetizedFromMove, FShooterStatus& OutStatus) const;
+	void Boost_Internal(FVector BoostVector, bool bBoostWasPressed, FShooterStatus& OutStatus) const;
+	void BoostRecharge_Internal(FShooterStatus& OutStatus, float DeltaTime) const;
+	FTransform PerformGravity(FShooterStatus& OutStatus, const IShooterWorldQuery& WorldQuery, float DeltaTime) const;
+	FVector Jump_Internal(bool bJumpWasPressed, FShooterStatus& OutStatus) const;
+
+	//landing on or leaving a floor, the client finds these from capsule hits and the server from the move
+	void ApplyFloorContact(EShooterFloorStatus ContactStatus, AActor* ContactFloor, FShooterStatus& OutStatus) const;
+	bool CanLandOn(EShooterFloorStatus ContactStatus, const AActor* ContactFloor, const FShooterStatus& InStatus) const;
+
+	static EShooterFloorStatus SetFloorStatus(EShooterFloorStatus StatusToChangeTo, FShooterStatus& StatusToReset);
+	static void ZeroOutGravity(FShooterStatus& StatusToReset);
+
+	FORCEINLINE const FShooterMovementSettings& GetSettings() const { return Settings; }
+
+private:
+	FShooterMovementSettings Settings;
+
+	FVector TotalMovementInput(const FVector ActionValue, const FShooterStatus& InStatus, float DeltaTime) const;
+	FVector CalculateMovementVelocity(FVector InMovementInput, FShooterStatus& OutStatus, float DeltaTime) const;
+
+	FRotator PitchLook_Internal(float PitchInput, FShooterStatus& OutStatus, float DeltaTime) const;
+	FRotator AddShooterSpin_Internal(float PitchInput, const FShooterStatus& InStatus, float DeltaTime) const;
+	FRotator YawLook_Internal(float YawInput, FShooterStatus& OutStatus, float DeltaTime) const;
+
+	void FindClosestFloor(const FVector& ActorLocation, FShooterStatus& OutStatus, const IShooterWorldQuery& WorldQuery, float DeltaTime) const;
+	FRotator OrientToGravity(FRotator InActorRotation, const FShooterStatus& InStatus, float DeltaTime) const;
+	FVector GravityForce(FVector InActorLocation, FShooterStatus& OutStatus, float DeltaTime) const;
+
+	void ContactedBoostForce(const FVector BoostVector, FShooterStatus& OutStatus) const;
+};
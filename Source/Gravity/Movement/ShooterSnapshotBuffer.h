@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/StaticArray.h"
+
+struct FShooterSnapshot
+{
+	float ServerTime = 0.f;
+	FVector Location = FVector::ZeroVector;
+	FQuat Rotation = FQuat::Identity;
+	//units per second, used as the hermite tangent and for extrapolating
+	FVector Velocity = FVector::ZeroVector;
+};
+
+/**
+ * The last few server states of a simulated proxy, ordered by server time.
+ * Proxies are drawn a little in the past so there's almost always a snapshot on both sides of the render time.
+ */
+class FShooterSnapshotBuffer
+{
+public:
+	static constexpr int32 Capacity = 32;
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity has to be a power of two");
+
+	FORCEINLINE int32 Num() const { return Count; }
+	FORCEINLINE bool IsEmpty() const { return Count == 0; }
+	FORCEINLINE const FShooterSnapshot& operator[](const int32 Index) const { return Snapshots[(Head + Index) & (Capacity - 1)]; }
+	FORCEINLINE const FShooterSnapshot& Last() const { return (*this)[Count - 1]; }
+
+	//out of order and duplicate snapshots are dropped
+	void Add(const FShooterSnapshot& Snapshot)
+	{
+		if(Count > 0 && Snapshot.ServerTime <= Last().ServerTime)
+		{
+			return;
+		}
+		if(Count == Capacity)
+		{
+			Head = (Head + 1) & (Capacity - 1);
+			Count--;
+		}
+		Snapshots[(Head + Count) & (Capacity - 1)] = Snapshot;
+		Count++;
+	}
+
+	/**
+	 * Hermite position and slerped rotation at RenderTime.
+	 * Past the newest snapshot it extrapolates along the newest velocity for at most MaxExtrapolationTime.
+	 */
+	bool Sample(const float RenderTime, const float MaxExtrapolationTime, FTransform& OutTransform) const
+	{
+		if(Count == 0)
+		{
+			return false;
+		}
+		const FShooterSnapshot& Oldest = (*this)[0];
+		if(RenderTime <= Oldest.ServerTime)
+		{
+			OutTransform = FTransform(Oldest.Rotation, Oldest.Location);
+			return true;
+		}
+		const FShooterSnapshot& Newest = Last();
+		if(RenderTime >= Newest.ServerTime)
+		{
+			const float ExtrapolationTime = FMath::Min(RenderTime - Newest.ServerTime, MaxExtrapolationTime);
+			OutTransform = FTransform(Newest.Rotation, Newest.Location + Newest.Velocity * ExtrapolationTime);
+			return true;
+		}
+		for(int32 Index = Count - 1; Index > 0; Index--)
+		{
+			const FShooterSnapshot& From = (*this)[Index - 1];
+			if(From.ServerTime <= RenderTime)
+			{
+				const FShooterSnapshot& To = (*this)[Index];
+				const float SegmentTime = To.ServerTime - From.ServerTime;
+				const float Alpha = (RenderTime - From.ServerTime) / SegmentTime;
+				const FVector Location = FMath::CubicInterp(From.Location, From.Velocity * SegmentTime, To.Location, To.Velocity * SegmentTime, Alpha);
+				OutTransform = FTransform(FQuat::Slerp(From.Rotation, To.Rotation, Alpha), Location);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void Reset()
+	{
+		Head = 0;
+		Count = 0;
+	}
+
+private:
+	TStaticArray<FShooterSnapshot, Capacity> Snapshots;
+	int32 Head = 0;
+	int32 Count = 0;
+};
@@ -0,0 +1,313 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterWorldQuery.h"
+
+#include "Components/PrimitiveComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "Gravity/Gravity.h"
+#include "Gravity/GravityStats.h"
+#include "Gravity/GravityField/GravityFieldVolume.h"
+#include "Gravity/Subsystems/GravityQuerySubsystem.h"
+#include "Gravity/Subsystems/GravitySourceSubsystem.h"
+#include "VisualLogger/VisualLogger.h"
+
+#include <atomic>
+
+namespace ShooterWorldQuery
+{
+	std::atomic<uint32> NumQueriesRun(0);
+
+	//closest point on the shell, from inside it the surface faces the center
+	void FindSphereSurface(const FVector& Location, const FGravitySource& Source, FVector& OutImpactPoint, FVector& OutImpactNormal)
+	{
+		const FVector FromCenter = Location - Source.Center;
+		const float DistanceFromCenter = FromCenter.Size();
+		const FVector Direction = DistanceFromCenter > KINDA_SMALL_NUMBER ? FromCenter / DistanceFromCenter : FVector::UpVector;
+		OutImpactPoint = Source.Center + Direction * Source.Radius;
+		OutImpactNormal = DistanceFromCenter < Source.Radius ? -Direction : Direction;
+	}
+
+	void FindBoxSurface(const FVector& Location, const FGravitySource& Source, FVector& OutImpactPoint, FVector& OutImpactNormal)
+	{
+		const FVector Local = Source.Rotation.UnrotateVector(Location - Source.Center);
+		const FVector Extent = Source.HalfExtent;
+		FVector Closest(
+			FMath::Clamp(Local.X, -Extent.X, Extent.X),
+			FMath::Clamp(Local.Y, -Extent.Y, Extent.Y),
+			FMath::Clamp(Local.Z, -Extent.Z, Extent.Z));
+		FVector LocalNormal;
+		if(Closest.Equals(Local, KINDA_SMALL_NUMBER))
+		{
+			//inside the box, push out through the nearest face
+			const FVector FaceGaps = Extent - Local.GetAbs();
+			const int32 Axis = FaceGaps.X <= FaceGaps.Y && FaceGaps.X <= FaceGaps.Z ? 0 : (FaceGaps.Y <= FaceGaps.Z ? 1 : 2);
+			const float Side = Local[Axis] >= 0.f ? 1.f : -1.f;
+			Closest[Axis] = Extent[Axis] * Side;
+			LocalNormal = FVector::ZeroVector;
+			LocalNormal[Axis] = Side;
+		}
+		else
+		{
+			LocalNormal = (Local - Closest).GetSafeNormal();
+		}
+		OutImpactPoint = Source.Center + Source.Rotation.RotateVector(Closest);
+		OutImpactNormal = Source.Rotation.RotateVector(LocalNormal);
+	}
+}
+
+void FShooterWorldQuery::MakeSurfaceHit(const FVector& Location, const FVector& ImpactPoint, const FVector& ImpactNormal, const float TraceRadius, AActor* Floor, UPrimitiveComponent* FloorComponent, FHitResult& OutHit)
+{
+	const float SurfaceDistance = (ImpactPoint - Location).Size();
+	const FVector TraceDirection = SurfaceDistance > KINDA_SMALL_NUMBER ? (ImpactPoint - Location) / SurfaceDistance : -ImpactNormal;
+	OutHit = FHitResult(Location, ImpactPoint);
+	OutHit.bBlockingHit = true;
+	OutHit.bStartPenetrating = SurfaceDistance < TraceRadius;
+	OutHit.Distance = FMath::Max(SurfaceDistance - TraceRadius, 0.f);
+	OutHit.Time = SurfaceDistance > KINDA_SMALL_NUMBER ? OutHit.Distance / SurfaceDistance : 0.f;
+	OutHit.Location = Location + TraceDirection * OutHit.Distance;
+	OutHit.ImpactPoint = ImpactPoint;
+	OutHit.Normal = ImpactNormal;
+	OutHit.ImpactNormal = ImpactNormal;
+	OutHit.HitObjectHandle = FActorInstanceHandle(Floor);
+	OutHit.Component = FloorComponent;
+}
+
+uint32 FShooterWorldQuery::GetNumQueriesRun()
+{
+	return ShooterWorldQuery::NumQueriesRun.load(std::memory_order_relaxed);
+}
+
+FShooterWorldQuery::FShooterWorldQuery(const UWorld* InWorld, const AActor* InGravityLevelSphere, const float InGravityDistanceRadius, const float InSphereTraceRadius, const UObject* InLogOwner)
+	: World(InWorld)
+	, GravitySources(InWorld ? InWorld->GetSubsystem<UGravitySourceSubsystem>() : nullptr)
+	, GravityLevelSphere(InGravityLevelSphere)
+	, GravityDistanceRadius(InGravityDistanceRadius)
+	, SphereTraceRadius(InSphereTraceRadius)
+	, LogOwner(InLogOwner)
+{
+}
+
+bool FShooterWorldQuery::FindClosestFloor(const FVector& Location, const float CurrentClosestDistance, FShooterFloorQueryResult& OutResult) const
+{
+	//although feet makes more sense for magnetized boots, head position plays more predictably
+	INC_DWORD_STAT(STAT_GravityFloorQueries);
+	ShooterWorldQuery::NumQueriesRun.fetch_add(1, std::memory_order_relaxed);
+	const bool bFoundCloserFloor = FindClosestSourceFloor(Location, CurrentClosestDistance, OutResult);
+#if ENABLE_VISUAL_LOG
+	if(LogOwner)
+	{
+		UE_VLOG_LOCATION(LogOwner, LogGravity, Verbose, Location, GravityDistanceRadius, FColor::Green, TEXT("Gravity radius"));
+		if(bFoundCloserFloor)
+		{
+			UE_VLOG_SEGMENT(LogOwner, LogGravity, Log, Location, OutResult.FloorHitResult.ImpactPoint, FColor::Red, TEXT("Floor %s %.0f"), *GetNameSafe(OutResult.Floor), OutResult.Distance);
+		}
+	}
+#endif
+	return bFoundCloserFloor;
+}
+
+bool FShooterWorldQuery::FindClosestSourceFloor(const FVector& Location, const float CurrentClosestDistance, FShooterFloorQueryResult& OutResult) const
+{
+	if(GravitySources && GravitySources->Num() > 0)
+	{
+		if(const AGravityFieldVolume* Field = GravitySources->FindField(Location))
+		{
+			FShooterFloorQueryResult FieldResult;
+			if(Field->Sample(Location, GravityDistanceRadius, SphereTraceRadius, FieldResult))
+			{
+				if(FieldResult.Distance >= CurrentClosestDistance)
+				{
+					return false;
+				}
+				OutResult = FieldResult;
+				return true;
+			}
+		}
+		return FindClosestRegisteredFloor(Location, CurrentClosestDistance, OutResult);
+	}
+	return FindClosestPhysicsFloor(Location, CurrentClosestDistance, OutResult);
+}
+
+bool FShooterWorldQuery::FindClosestRegisteredFloor(const FVector& Location, const float CurrentClosestDistance, FShooterFloorQueryResult& OutResult) const
+{
+	FGravitySourceList SourcesInRange;
+	GravitySources->FindSourcesInRange(Location, GravityDistanceRadius, SourcesInRange);
+	float ClosestDistance = CurrentClosestDistance;
+	bool bFoundCloserFloor = false;
+	for(const int32 SourceIndex : SourcesInRange)
+	{
+		const FGravitySource& Source = GravitySources->GetSource(SourceIndex);
+		AActor* FloorActor = Source.Actor.Get();
+		FHitResult FindFloorHitResult;
+		if(!FindSourceSurface(Location, Source, FindFloorHitResult))
+		{
+			continue;
+		}
+		const float ImpactDistance = (FindFloorHitResult.ImpactPoint - Location).Size();
+		//bounds are loose, the overlap this replaces only counted geometry inside the gravity radius
+		if(ImpactDistance > GravityDistanceRadius || ImpactDistance >= ClosestDistance)
+		{
+			continue;
+		}
+		ClosestDistance = ImpactDistance;
+		OutResult.FloorHitResult = FindFloorHitResult;
+		OutResult.Distance = ClosestDistance;
+		OutResult.Floor = FloorActor;
+		bFoundCloserFloor = true;
+	}
+	return bFoundCloserFloor;
+}
+
+bool FShooterWorldQuery::FindFloorSurface(const FVector& Location, const AActor* Floor, FShooterFloorQueryResult& OutResult) const
+{
+	const FGravitySource* Source = GravitySources && Floor ? GravitySources->FindSource(Floor) : nullptr;
+	if(Source == nullptr || !FindSourceSurface(Location, *Source, OutResult.FloorHitResult))
+	{
+		return false;
+	}
+	OutResult.Floor = Source->Actor.Get();
+	OutResult.Distance = (OutResult.FloorHitResult.ImpactPoint - Location).Size();
+	return true;
+}
+
+bool FShooterWorldQuery::FindSourceSurface(const FVector& Location, const FGravitySource& Source, FHitResult& OutHit) const
+{
+	AActor* FloorActor = Source.Actor.Get();
+	UPrimitiveComponent* FloorComponent = Source.Component.Get();
+	if(FloorActor == nullptr || FloorComponent == nullptr)
+	{
+		return false;
+	}
+	if(Source.Shape == EGravitySourceShape::Mesh)
+	{
+		//arbitrary meshes still need the sweep, against the floor's own geometry only
+		const FVector SweepEnd = FloorActor == GravityLevelSphere ?
+			Location + (Location - GravityLevelSphere->GetActorLocation()).GetSafeNormal() * GravityDistanceRadius :
+			FloorActor->GetActorLocation();
+		INC_DWORD_STAT(STAT_GravityFloorSweeps);
+		return FloorComponent->SweepComponent(OutHit, Location, SweepEnd, FQuat::Identity, FCollisionShape::MakeSphere(SphereTraceRadius));
+	}
+	//spheres and boxes are solved exactly, nothing here touches the physics scene
+	FVector ImpactPoint;
+	FVector ImpactNormal;
+	if(Source.Shape == EGravitySourceShape::Sphere)
+	{
+		ShooterWorldQuery::FindSphereSurface(Location, Source, ImpactPoint, ImpactNormal);
+	}
+	else
+	{
+		ShooterWorldQuery::FindBoxSurface(Location, Source, ImpactPoint, ImpactNormal);
+	}
+	MakeSurfaceHit(Location, ImpactPoint, ImpactNormal, SphereTraceRadius, FloorActor, FloorComponent, OutHit);
+	return true;
+}
+
+bool FShooterWorldQuery::FindClosestPhysicsFloor(const FVector& Location, const float CurrentClosestDistance, FShooterFloorQueryResult& OutResult) const
+{
+	if(World == nullptr)
+	{
+		return false;
+	}
+	TArray<FOverlapResult> HitOverlaps;
+	FCollisionQueryParams QueryParams;
+	FCollisionResponseParams ResponseParams;
+	const FCollisionShape GravitySphere = FCollisionShape::MakeSphere(GravityDistanceRadius);
+	const FCollisionShape TraceShape = FCollisionShape::MakeSphere(SphereTraceRadius);
+
+	World->OverlapMultiByChannel(HitOverlaps, Location, FQuat::Identity, ECC_GameTraceChannel1, GravitySphere, QueryParams, ResponseParams);
+	float ClosestDistance = CurrentClosestDistance;
+	bool bFoundCloserFloor = false;
+	//use a sphere trace to hit a part of the floor that is closer to the player than the center
+	for(const FOverlapResult& Floor : HitOverlaps)
+	{
+		const AActor* FloorActor = Floor.GetActor();
+		if(FloorActor == nullptr)
+		{
+			continue;
+		}
+		FHitResult FindFloorHitResult;
+		INC_DWORD_STAT(STAT_GravityFloorSweeps);
+		if(FloorActor == GravityLevelSphere)
+		{
+			World->SweepSingleByChannel(FindFloorHitResult, Location, Location + (Location - GravityLevelSphere->GetActorLocation()).GetSafeNormal() * GravityDistanceRadius, FQuat::Identity, ECC_GameTraceChannel1, TraceShape, QueryParams, ResponseParams);
+		}
+		else
+		{
+			World->SweepSingleByChannel(FindFloorHitResult, Location, FloorActor->GetActorLocation(), FQuat::Identity, ECC_GameTraceChannel1, TraceShape, QueryParams, ResponseParams);
+		}
+		if(FindFloorHitResult.bBlockingHit && (FindFloorHitResult.ImpactPoint - Location).Size() < ClosestDistance)
+		{
+			ClosestDistance = (FindFloorHitResult.ImpactPoint - Location).Size();
+			OutResult.FloorHitResult = FindFloorHitResult;
+			OutResult.Distance = ClosestDistance;
+			OutResult.Floor = Floor.GetActor();
+			bFoundCloserFloor = true;
+		}
+	}
+	return bFoundCloserFloor;
+}
+
+FVector FShooterWorldQuery::GetGravitySourceLocation(const AActor* GravitySource) const
+{
+	return GravitySource ? GravitySource->GetActorLocation() : FVector::ZeroVector;
+}
+
+FShooterBatchedWorldQuery::FShooterBatchedWorldQuery(const FShooterWorldQuery& InLiveQuery, UGravityQuerySubsystem* InQuerySubsystem, const AActor* InRequester, const AActor* InGravityLevelSphere, const float InGravityDistanceRadius, const float InSphereTraceRadius)
+	: LiveQuery(InLiveQuery)
+	, QuerySubsystem(InQuerySubsystem)
+	, Requester(InRequester)
+	, GravityLevelSphere(InGravityLevelSphere)
+	, GravityDistanceRadius(InGravityDistanceRadius)
+	, SphereTraceRadius(InSphereTraceRadius)
+{
+}
+
+bool FShooterBatchedWorldQuery::FindClosestFloor(const FVector& Location, const float CurrentClosestDistance, FShooterFloorQueryResult& OutResult) const
+{
+	if(QuerySubsystem == nullptr)
+	{
+		return LiveQuery.FindClosestFloor(Location, CurrentClosestDistance, OutResult);
+	}
+	FGravityQueryRequest Request;
+	Request.Requester = Requester;
+	Request.GravityLevelSphere = GravityLevelSphere;
+	Request.Location = Location;
+	Request.GravityDistanceRadius = GravityDistanceRadius;
+	Request.SphereTraceRadius = SphereTraceRadius;
+	QuerySubsystem->QueueQuery(Request);
+
+	FGravityQueryResponse Response;
+	if(!QuerySubsystem->ConsumeResponse(Requester, Response))
+	{
+		return LiveQuery.FindClosestFloor(Location, CurrentClosestDistance, OutResult);
+	}
+	if(!Response.bFoundFloor)
+	{
+		return false;
+	}
+	//the surface point is a step old, the hit is rebuilt from where we are now
+	const FHitResult& BatchedHit = Response.Result.FloorHitResult;
+	const float Distance = (BatchedHit.ImpactPoint - Location).Size();
+	if(Distance > GravityDistanceRadius || Distance >= CurrentClosestDistance)
+	{
+		return false;
+	}
+	AActor* Floor = Response.Result.Floor;
+	MakeSurfaceHit(Location, BatchedHit.ImpactPoint, BatchedHit.ImpactNormal, SphereTraceRadius, Floor, BatchedHit.GetComponent(), OutResult.FloorHitResult);
+	OutResult.Floor = Floor;
+	OutResult.Distance = Distance;
+	return true;
+}
+
+bool FShooterBatchedWorldQuery::FindFloorSurface(const FVector& Location, const AActor* Floor, FShooterFloorQueryResult& OutResult) const
+{
+	//a single floor is cheap enough to solve inline
+	return LiveQuery.FindFloorSurface(Location, Floor, OutResult);
+}
+
+FVector FShooterBatchedWorldQuery::GetGravitySourceLocation(const AActor* GravitySource) const
+{
+	return LiveQuery.GetGravitySourceLocation(GravitySource);
+}
@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/HitResult.h"
+
+class UGravityQuerySubsystem;
+class UGravitySourceSubsystem;
+class UPrimitiveComponent;
+struct FGravitySource;
+
+struct FShooterFloorQueryResult
+{
+	FHitResult FloorHitResult;
+	AActor* Floor = nullptr;
+	float Distance = FLT_MAX;
+};
+
+/**
+ * Read-only view of the world that the movement simulation is allowed to use during a step.
+ */
+class GRAVITY_API IShooterWorldQuery
+{
+public:
+	virtual ~IShooterWorldQuery() = default;
+
+	//returns true and fills OutResult if a floor closer than CurrentClosestDistance is in range of Location
+	virtual bool FindClosestFloor(const FVector& Location, float CurrentClosestDistance, FShooterFloorQueryResult& OutResult) const = 0;
+	//the closest point on one particular floor, false if that floor can't be solved on its own
+	virtual bool FindFloorSurface(const FVector& Location, const AActor* Floor, FShooterFloorQueryResult& OutResult) const = 0;
+
+	virtual FVector GetGravitySourceLocation(const AActor* GravitySource) const = 0;
+};
+
+/**
+ * World query backed by the gravity source registry, this is what the pawns use in game.
+ * Worlds without registered sources fall back to overlapping the physics scene.
+ */
+class GRAVITY_API FShooterWorldQuery : public IShooterWorldQuery
+{
+public:
+	FShooterWorldQuery(const UWorld* InWorld, const AActor* InGravityLevelSphere, float InGravityDistanceRadius, float InSphereTraceRadius, const UObject* InLogOwner = nullptr);
+
+	virtual bool FindClosestFloor(const FVector& Location, float CurrentClosestDistance, FShooterFloorQueryResult& OutResult) const override;
+	//only registered sources can be solved alone, physics floors always need the full query
+	virtual bool FindFloorSurface(const FVector& Location, const AActor* Floor, FShooterFloorQueryResult& OutResult) const override;
+	virtual FVector GetGravitySourceLocation(const AActor* GravitySource) const override;
+
+	/**
+	 * Fills a hit the way a sphere sweep from Location toward the surface would have.
+	 * Distance is how far the trace sphere travels before touching, 0 if it starts overlapping.
+	 */
+	static void MakeSurfaceHit(const FVector& Location, const FVector& ImpactPoint, const FVector& ImpactNormal, float TraceRadius, AActor* Floor, UPrimitiveComponent* FloorComponent, FHitResult& OutHit);
+
+	//every floor query any FShooterWorldQuery has run, on any thread, for the perf tests to count per tick
+	static uint32 GetNumQueriesRun();
+
+private:
+	bool FindClosestSourceFloor(const FVector& Location, float CurrentClosestDistance, FShooterFloorQueryResult& OutResult) const;
+	bool FindClosestRegisteredFloor(const FVector& Location, float CurrentClosestDistance, FShooterFloorQueryResult& OutResult) const;
+	bool FindClosestPhysicsFloor(const FVector& Location, float CurrentClosestDistance, FShooterFloorQueryResult& OutResult) const;
+	//spheres and boxes exactly, meshes with a sweep against their own geometry
+	bool FindSourceSurface(const FVector& Location, const FGravitySource& Source, FHitResult& OutHit) const;
+
+	const UWorld* World;
+	const UGravitySourceSubsystem* GravitySources;
+	const AActor* GravityLevelSphere;
+	float GravityDistanceRadius;
+	float SphereTraceRadius;
+	//visual logger entries go on this object, null for queries run off the game thread
+	const UObject* LogOwner;
+};
+
+/**
+ * Reads the closest floor from the last batch the query subsystem ran and queues this step's location for the next one.
+ * A step with no answer waiting, the first airborne one or a second one in the same frame, asks the world directly.
+ */
+class GRAVITY_API FShooterBatchedWorldQuery : public IShooterWorldQuery
+{
+public:
+	FShooterBatchedWorldQuery(const FShooterWorldQuery& InLiveQuery, UGravityQuerySubsystem* InQuerySubsystem, const AActor* InRequester, const AActor* InGravityLevelSphere, float InGravityDistanceRadius, float InSphereTraceRadius);
+
+	virtual bool FindClosestFloor(const FVector& Location, float CurrentClosestDistance, FShooterFloorQueryResult& OutResult) const override;
+	virtual bool FindFloorSurface(const FVector& Location, const AActor* Floor, FShooterFloorQueryResult& OutResult) const override;
+	virtual FVector GetGravitySourceLocation(const AActor* GravitySource) const override;
+
+private:
+	FShooterWorldQuery LiveQuery;
+	UGravityQuerySubsystem* QuerySubsystem;
+	const AActor* Requester;
+	const AActor* GravityLevelSphere;
+	float GravityDistanceRadius;
+	float SphereTraceRadius;
+};
@@ -0,0 +1,363 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityReplicationGraph.h"
+
+#include "EngineUtils.h"
+#include "Engine/NetConnection.h"
+#include "GameFramework/Info.h"
+#include "Gravity/Characters/BasePawnPlayer.h"
+#include "Gravity/Sphere/GravitySphere.h"
+#include "Gravity/Weapons/BulletBase.h"
+
+UGravityReplicationGraph::UGravityReplicationGraph()
+{
+	PawnFrequencyBuckets = {
+		{5000.f, 1},
+		{10000.f, 2},
+		{20000.f, 4},
+	};
+}
+
+void UGravityReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	const float PawnCullDistance = PawnFrequencyBuckets.Num() > 0 ? PawnFrequencyBuckets.Last().MaxDistance : 20000.f;
+	int32 SlowestPawnPeriod = 1;
+	for(const FGravityRepFrequencyBucket& Bucket : PawnFrequencyBuckets)
+	{
+		SlowestPawnPeriod = FMath::Max(SlowestPawnPeriod, Bucket.FramePeriod);
+	}
+
+	FClassReplicationInfo PawnInfo;
+	PawnInfo.SetCullDistanceSquared(FMath::Square(PawnCullDistance));
+	PawnInfo.ReplicationPeriodFrame = 1;
+	//a pawn in a slow bucket is skipped on most frames, don't let that close its channel
+	PawnInfo.ActorChannelFrameTimeout = FMath::Clamp(SlowestPawnPeriod + 4, 4, 255);
+	GlobalActorReplicationInfoMap.SetClassInfo(ABasePawnPlayer::StaticClass(), PawnInfo);
+
+	FClassReplicationInfo BulletInfo;
+	BulletInfo.SetCullDistanceSquared(FMath::Square(BulletCullDistance));
+	BulletInfo.ReplicationPeriodFrame = 1;
+	GlobalActorReplicationInfoMap.SetClassInfo(ABulletBase::StaticClass(), BulletInfo);
+}
+
+void UGravityReplicationGraph::InitGlobalGraphNodes()
+{
+	AlwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AddGlobalGraphNode(AlwaysRelevantNode);
+
+	OwnerOnlyNode = CreateNewNode<UGravityReplicationGraphNode_OwnerOnly>();
+	AddGlobalGraphNode(OwnerOnlyNode);
+
+	SphereGridNode = CreateNewNode<UGravityReplicationGraphNode_SphereGrid>();
+	SphereGridNode->CellSize = GridCellSize;
+	SphereGridNode->FrequencyBuckets = PawnFrequencyBuckets;
+	SphereGridNode->GatherDistance = FMath::Max(PawnFrequencyBuckets.Num() > 0 ? PawnFrequencyBuckets.Last().MaxDistance : 0.f, BulletCullDistance);
+	SphereGridNode->bCullAcrossSiblingSpheres = bCullAcrossSiblingSpheres;
+	AddGlobalGraphNode(SphereGridNode);
+}
+
+void UGravityReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection)
+{
+	Super::InitConnectionGraphNodes(RepGraphConnection);
+
+	//also picks up the connection's own controller and view target
+	UReplicationGraphNode_AlwaysRelevant_ForConnection* OwnerRelevantNode = CreateNewNode<UReplicationGraphNode_AlwaysRelevant_ForConnection>();
+	AddConnectionGraphNode(OwnerRelevantNode, RepGraphConnection);
+}
+
+void UGravityReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo)
+{
+	AActor* Actor = ActorInfo.Actor;
+	if(Actor->bOnlyRelevantToOwner)
+	{
+		OwnerOnlyNode->NotifyAddNetworkActor(ActorInfo);
+		return;
+	}
+	if(Actor->bAlwaysRelevant || Actor->IsA<AInfo>())
+	{
+		AlwaysRelevantNode->NotifyAddNetworkActor(ActorInfo);
+		return;
+	}
+	SphereGridNode->NotifyAddNetworkActor(ActorInfo);
+}
+
+void UGravityReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	AActor* Actor = ActorInfo.Actor;
+	if(Actor->bOnlyRelevantToOwner)
+	{
+		OwnerOnlyNode->NotifyRemoveNetworkActor(ActorInfo);
+		return;
+	}
+	if(Actor->bAlwaysRelevant || Actor->IsA<AInfo>())
+	{
+		AlwaysRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+		return;
+	}
+	SphereGridNode->NotifyRemoveNetworkActor(ActorInfo);
+}
+
+UGravityReplicationGraphNode_OwnerOnly::UGravityReplicationGraphNode_OwnerOnly()
+{
+	bRequiresPrepareForReplicationCall = true;
+}
+
+void UGravityReplicationGraphNode_OwnerOnly::NotifyAddNetworkActor(const FNewReplicatedActorInfo& ActorInfo)
+{
+	Actors.Add(ActorInfo.Actor);
+}
+
+bool UGravityReplicationGraphNode_OwnerOnly::NotifyRemoveNetworkActor(const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound)
+{
+	if(Actors.RemoveSingleSwap(ActorInfo.Actor, false) == 0)
+	{
+		UE_CLOG(bWarnIfNotFound, LogNet, Warning, TEXT("OwnerOnly: %s was never added"), *GetNameSafe(ActorInfo.Actor));
+		return false;
+	}
+	//the per connection lists still hold it until the next prepare
+	for(TPair<UNetConnection*, FActorRepListRefView>& ConnectionActors : ActorsByConnection)
+	{
+		ConnectionActors.Value.RemoveFast(ActorInfo.Actor);
+	}
+	return true;
+}
+
+void UGravityReplicationGraphNode_OwnerOnly::NotifyResetAllNetworkActors()
+{
+	Actors.Reset();
+	ActorsByConnection.Reset();
+}
+
+void UGravityReplicationGraphNode_OwnerOnly::PrepareForReplication()
+{
+	for(TPair<UNetConnection*, FActorRepListRefView>& ConnectionActors : ActorsByConnection)
+	{
+		ConnectionActors.Value.Reset();
+	}
+	for(const FActorRepListType Actor : Actors)
+	{
+		//actors without an owning connection yet are skipped until they get one
+		if(UNetConnection* Connection = Actor->GetNetConnection())
+		{
+			ActorsByConnection.FindOrAdd(Connection).Add(Actor);
+		}
+	}
+	//closed connections don't own anything anymore
+	for(auto It = ActorsByConnection.CreateIterator(); It; ++It)
+	{
+		if(It.Value().Num() == 0)
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+void UGravityReplicationGraphNode_OwnerOnly::GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params)
+{
+	const FActorRepListRefView* ConnectionActors = ActorsByConnection.Find(Params.ConnectionManager.NetConnection);
+	if(ConnectionActors && ConnectionActors->Num() > 0)
+	{
+		Params.OutGatheredReplicationLists.AddReplicationActorList(*ConnectionActors);
+	}
+}
+
+UGravityReplicationGraphNode_SphereGrid::UGravityReplicationGraphNode_SphereGrid()
+{
+	bRequiresPrepareForReplicationCall = true;
+}
+
+void UGravityReplicationGraphNode_SphereGrid::NotifyAddNetworkActor(const FNewReplicatedActorInfo& ActorInfo)
+{
+	FGridActor& GridActor = GridActors.AddDefaulted_GetRef();
+	GridActor.Actor = ActorInfo.Actor;
+	GridActor.bUseFrequencyBuckets = ActorInfo.Actor->IsA<ABasePawnPlayer>();
+}
+
+bool UGravityReplicationGraphNode_SphereGrid::NotifyRemoveNetworkActor(const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound)
+{
+	const int32 GridActorIndex = GridActors.IndexOfByPredicate([&ActorInfo](const FGridActor& GridActor) { return GridActor.Actor == ActorInfo.Actor; });
+	if(GridActorIndex == INDEX_NONE)
+	{
+		UE_CLOG(bWarnIfNotFound, LogNet, Warning, TEXT("SphereGrid: %s was never added"), *GetNameSafe(ActorInfo.Actor));
+		return false;
+	}
+	//cell lists hold indices, they're rebuilt before the next gather anyway
+	GridActors.RemoveAtSwap(GridActorIndex, 1, false);
+	for(TPair<FIntVector, TArray<int32>>& Cell : Cells)
+	{
+		Cell.Value.Reset();
+	}
+	return true;
+}
+
+void UGravityReplicationGraphNode_SphereGrid::NotifyResetAllNetworkActors()
+{
+	GridActors.Reset();
+	Cells.Reset();
+	SphereLevels.Reset();
+	bSphereLevelsGathered = false;
+}
+
+void UGravityReplicationGraphNode_SphereGrid::PrepareForReplication()
+{
+	const UWorld* World = GraphGlobals.IsValid() ? GraphGlobals->World : nullptr;
+	if(!bSphereLevelsGathered || (World && World->GetLevels().Num() != GatheredLevelCount))
+	{
+		GatherSphereLevels();
+	}
+
+	for(TPair<FIntVector, TArray<int32>>& Cell : Cells)
+	{
+		Cell.Value.Reset();
+	}
+	for(int32 GridActorIndex = 0; GridActorIndex < GridActors.Num(); GridActorIndex++)
+	{
+		FGridActor& GridActor = GridActors[GridActorIndex];
+		GridActor.Location = GridActor.Actor->GetActorLocation();
+		GridActor.SphereLevel = FindSphereLevel(GridActor.Location);
+		Cells.FindOrAdd(GetCell(GridActor.Location)).Add(GridActorIndex);
+	}
+}
+
+void UGravityReplicationGraphNode_SphereGrid::GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params)
+{
+	GatheredActors.Reset();
+	//stamps keep an actor seen by two viewers of the same connection from going in twice
+	CurrentGatherStamp++;
+
+	const int32 CellRadius = FMath::CeilToInt(GatherDistance / CellSize);
+	for(const FNetViewer& Viewer : Params.Viewers)
+	{
+		const FIntVector ViewerCell = GetCell(Viewer.ViewLocation);
+		const int32 ViewerSphereLevel = FindSphereLevel(Viewer.ViewLocation);
+		for(int32 X = -CellRadius; X <= CellRadius; X++)
+		{
+			for(int32 Y = -CellRadius; Y <= CellRadius; Y++)
+			{
+				for(int32 Z = -CellRadius; Z <= CellRadius; Z++)
+				{
+					const TArray<int32>* Cell = Cells.Find(ViewerCell + FIntVector(X, Y, Z));
+					if(Cell == nullptr)
+					{
+						continue;
+					}
+					for(const int32 GridActorIndex : *Cell)
+					{
+						FGridActor& GridActor = GridActors[GridActorIndex];
+						if(GridActor.GatherStamp == CurrentGatherStamp)
+						{
+							continue;
+						}
+						if(bCullAcrossSiblingSpheres && !AreOnSameSphereChain(ViewerSphereLevel, GridActor.SphereLevel))
+						{
+							continue;
+						}
+						if(GridActor.bUseFrequencyBuckets)
+						{
+							const int32 FramePeriod = FindFramePeriod(FVector::DistSquared(Viewer.ViewLocation, GridActor.Location));
+							//offset by the actor so a bucket's pawns don't all go out on the same frame
+							if(FramePeriod <= 0 || (Params.ReplicationFrameNum + GridActorIndex) % FramePeriod != 0)
+							{
+								continue;
+							}
+						}
+						GridActor.GatherStamp = CurrentGatherStamp;
+						GatheredActors.Add(GridActor.Actor);
+					}
+				}
+			}
+		}
+	}
+	if(GatheredActors.Num() > 0)
+	{
+		Params.OutGatheredReplicationLists.AddReplicationActorList(GatheredActors);
+	}
+}
+
+void UGravityReplicationGraphNode_SphereGrid::GatherSphereLevels()
+{
+	SphereLevels.Reset();
+	const UWorld* World = GraphGlobals.IsValid() ? GraphGlobals->World : nullptr;
+	if(World == nullptr)
+	{
+		return;
+	}
+	GatheredLevelCount = World->GetLevels().Num();
+	for(TActorIterator<AGravitySphere> It(World); It; ++It)
+	{
+		FSphereLevel& SphereLevel = SphereLevels.AddDefaulted_GetRef();
+		SphereLevel.Sphere = *It;
+		SphereLevel.Center = It->GetActorLocation();
+		SphereLevel.Radius = It->GetGravityRadius();
+	}
+	//smallest first, so the first sphere that contains a point is the innermost one
+	SphereLevels.Sort([](const FSphereLevel& A, const FSphereLevel& B) { return A.Radius < B.Radius; });
+	for(int32 LevelIndex = 0; LevelIndex < SphereLevels.Num(); LevelIndex++)
+	{
+		for(int32 ParentIndex = LevelIndex + 1; ParentIndex < SphereLevels.Num(); ParentIndex++)
+		{
+			if(FVector::DistSquared(SphereLevels[LevelIndex].Center, SphereLevels[ParentIndex].Center) < FMath::Square(SphereLevels[ParentIndex].Radius))
+			{
+				SphereLevels[LevelIndex].Parent = ParentIndex;
+				break;
+			}
+		}
+	}
+	bSphereLevelsGathered = true;
+}
+
+int32 UGravityReplicationGraphNode_SphereGrid::FindSphereLevel(const FVector& Location) const
+{
+	for(int32 LevelIndex = 0; LevelIndex < SphereLevels.Num(); LevelIndex++)
+	{
+		if(FVector::DistSquared(Location, SphereLevels[LevelIndex].Center) < FMath::Square(SphereLevels[LevelIndex].Radius))
+		{
+			return LevelIndex;
+		}
+	}
+	return INDEX_NONE;
+}
+
+bool UGravityReplicationGraphNode_SphereGrid::AreOnSameSphereChain(const int32 LevelA, const int32 LevelB) const
+{
+	//outside every sphere is the root, it sees and is seen by everything
+	if(LevelA == INDEX_NONE || LevelB == INDEX_NONE || LevelA == LevelB)
+	{
+		return true;
+	}
+	//parents are always larger, so only the smaller level can be nested in the other
+	int32 Inner = FMath::Min(LevelA, LevelB);
+	const int32 Outer = FMath::Max(LevelA, LevelB);
+	while(Inner != INDEX_NONE)
+	{
+		if(Inner == Outer)
+		{
+			return true;
+		}
+		Inner = SphereLevels[Inner].Parent;
+	}
+	return false;
+}
+
+int32 UGravityReplicationGraphNode_SphereGrid::FindFramePeriod(const float DistanceSquared) const
+{
+	for(const FGravityRepFrequencyBucket& Bucket : FrequencyBuckets)
+	{
+		if(DistanceSquared < FMath::Square(Bucket.MaxDistance))
+		{
+			return FMath::Max(Bucket.FramePeriod, 1);
+		}
+	}
+	return FrequencyBuckets.Num() > 0 ? 0 : 1;
+}
+
+FIntVector UGravityReplicationGraphNode_SphereGrid::GetCell(const FVector& Location) const
+{
+	return FIntVector(
+		FMath::FloorToInt(Location.X / CellSize),
+		FMath::FloorToInt(Location.Y / CellSize),
+		FMath::FloorToInt(Location.Z / CellSize));
+}
@@ -0,0 +1,148 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+#include "GravityReplicationGraph.generated.h"
+
+class AGravitySphere;
+class UGravityReplicationGraphNode_OwnerOnly;
+class UGravityReplicationGraphNode_SphereGrid;
+
+USTRUCT()
+struct FGravityRepFrequencyBucket
+{
+	GENERATED_BODY()
+
+	//pawns closer than this to the viewer land in this bucket
+	UPROPERTY(EditAnywhere)
+	float MaxDistance = 0.f;
+	//replicate once every this many frames
+	UPROPERTY(EditAnywhere)
+	int32 FramePeriod = 1;
+};
+
+/**
+ * Replication graph for the gravity arenas.
+ * Owner only actors go to whichever connection owns them that frame, info actors are always relevant and everything else
+ * goes through a 3D grid that knows which gravity sphere an actor is inside.
+ */
+UCLASS(transient, config=Engine)
+class GRAVITY_API UGravityReplicationGraph : public UReplicationGraph
+{
+	GENERATED_BODY()
+
+public:
+	UGravityReplicationGraph();
+
+	virtual void InitGlobalActorClassSettings() override;
+	virtual void InitGlobalGraphNodes() override;
+	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection) override;
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+
+	//edge length of a grid cell, roughly the size of the smallest arena
+	UPROPERTY(Config)
+	float GridCellSize = 5000.f;
+	//pawns beyond the last bucket aren't replicated at all
+	UPROPERTY(Config)
+	TArray<FGravityRepFrequencyBucket> PawnFrequencyBuckets;
+	UPROPERTY(Config)
+	float BulletCullDistance = 10000.f;
+	//actors inside one sphere can't be seen from inside a sibling sphere
+	UPROPERTY(Config)
+	bool bCullAcrossSiblingSpheres = true;
+
+private:
+	UPROPERTY()
+	UReplicationGraphNode_ActorList* AlwaysRelevantNode;
+	UPROPERTY()
+	UGravityReplicationGraphNode_OwnerOnly* OwnerOnlyNode;
+	UPROPERTY()
+	UGravityReplicationGraphNode_SphereGrid* SphereGridNode;
+};
+
+/**
+ * Owner only actors, handed to their owning connection.
+ * Owners are looked up again every frame, an actor often has none yet when it's added and can change hands later.
+ */
+UCLASS()
+class GRAVITY_API UGravityReplicationGraphNode_OwnerOnly : public UReplicationGraphNode
+{
+	GENERATED_BODY()
+
+public:
+	UGravityReplicationGraphNode_OwnerOnly();
+
+	virtual void NotifyAddNetworkActor(const FNewReplicatedActorInfo& ActorInfo) override;
+	virtual bool NotifyRemoveNetworkActor(const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound = true) override;
+	virtual void NotifyResetAllNetworkActors() override;
+	virtual void PrepareForReplication() override;
+	virtual void GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params) override;
+
+private:
+	TArray<FActorRepListType> Actors;
+	//rebuilt every frame from each actor's current owner
+	TMap<UNetConnection*, FActorRepListRefView> ActorsByConnection;
+};
+
+/**
+ * Buckets actors by 3D grid cell and by the innermost gravity sphere they're in.
+ * Arenas are spheres at any orientation, so the grid is cubic instead of the usual flat XY one.
+ */
+UCLASS()
+class GRAVITY_API UGravityReplicationGraphNode_SphereGrid : public UReplicationGraphNode
+{
+	GENERATED_BODY()
+
+public:
+	UGravityReplicationGraphNode_SphereGrid();
+
+	virtual void NotifyAddNetworkActor(const FNewReplicatedActorInfo& ActorInfo) override;
+	virtual bool NotifyRemoveNetworkActor(const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound = true) override;
+	virtual void NotifyResetAllNetworkActors() override;
+	virtual void PrepareForReplication() override;
+	virtual void GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params) override;
+
+	float CellSize = 5000.f;
+	//how far out cells are gathered, the graph still does the per actor cull distance check
+	float GatherDistance = 20000.f;
+	TArray<FGravityRepFrequencyBucket> FrequencyBuckets;
+	bool bCullAcrossSiblingSpheres = true;
+
+private:
+	struct FSphereLevel
+	{
+		TWeakObjectPtr<AGravitySphere> Sphere;
+		FVector Center = FVector::ZeroVector;
+		float Radius = 0.f;
+		int32 Parent = INDEX_NONE;
+	};
+
+	struct FGridActor
+	{
+		FActorRepListType Actor = nullptr;
+		FVector Location = FVector::ZeroVector;
+		int32 SphereLevel = INDEX_NONE;
+		uint32 GatherStamp = 0;
+		bool bUseFrequencyBuckets = false;
+	};
+
+	void GatherSphereLevels();
+	int32 FindSphereLevel(const FVector& Location) const;
+	bool AreOnSameSphereChain(int32 LevelA, int32 LevelB) const;
+	int32 FindFramePeriod(float DistanceSquared) const;
+	FIntVector GetCell(const FVector& Location) const;
+
+	TArray<FSphereLevel> SphereLevels;
+	bool bSphereLevelsGathered = false;
+	//streaming a level in or out changes the count, the spheres are gathered again then
+	int32 GatheredLevelCount = 0;
+
+	TArray<FGridActor> GridActors;
+	TMap<FIntVector, TArray<int32>> Cells;
+	uint32 CurrentGatherStamp = 0;
+
+	FActorRepListRefView GatheredActors;
+};
@@ -5,6 +5,7 @@
 
 #include "Components/ProgressBar.h"
 #include "Gravity/Characters/BasePawnPlayer.h"
+#include "Gravity/Components/ShooterBotComponent.h"
 #include "Gravity/Components/ShooterHealthComponent.h"
 #include "Gravity/HUD/ShooterHUD.h"
 #include "Gravity/HUD/UShooterOverlay.h"
@@ -20,6 +21,11 @@ void AGravityPlayerController::BeginPlay()
 		ShooterHUD->AddShooterOverlay();
 		SetHUDHealth();
 	}
+	if(IsLocalController() && UShooterBotComponent::IsBotClient())
+	{
+		UShooterBotComponent* Bot = NewObject<UShooterBotComponent>(this, TEXT("Bot"));
+		Bot->RegisterComponent();
+	}
 }
 
 void AGravityPlayerController::Tick(float DeltaSeconds)
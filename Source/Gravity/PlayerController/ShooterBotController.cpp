@@ -0,0 +1,11 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterBotController.h"
+
+#include "Gravity/Components/ShooterBotComponent.h"
+
+AShooterBotController::AShooterBotController()
+{
+	Bot = CreateDefaultSubobject<UShooterBotComponent>(TEXT("Bot"));
+}
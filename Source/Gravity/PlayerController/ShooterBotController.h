@@ -0,0 +1,26 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Controller.h"
+#include "ShooterBotController.generated.h"
+
+class UShooterBotComponent;
+
+/**
+ * Server side stand in for a connected player, its pawn is locally controlled on the server and driven by a bot.
+ * Spawned with Gravity.SpawnBots for capacity testing.
+ */
+UCLASS()
+class GRAVITY_API AShooterBotController : public AController
+{
+	GENERATED_BODY()
+
+public:
+	AShooterBotController();
+
+protected:
+	UPROPERTY(VisibleAnywhere)
+	UShooterBotComponent* Bot;
+};
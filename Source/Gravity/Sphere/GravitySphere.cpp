@@ -4,7 +4,9 @@
 #include "GravitySphere.h"
 
 #include "Components/SphereComponent.h"
+#include "Components/StaticMeshComponent.h"
 #include "Gravity/Characters/BasePawnPlayer.h"
+#include "Gravity/Subsystems/GravitySourceSubsystem.h"
 
 
 AGravitySphere::AGravitySphere()
@@ -25,6 +27,19 @@ void AGravitySphere::BeginPlay()
 		OverlapSphere->OnComponentBeginOverlap.AddDynamic(this, &AGravitySphere::AddSphereLevel);
 	}
 	BeginPlayAddSphereLevel();
+	if(UGravitySourceSubsystem* GravitySources = GetWorld()->GetSubsystem<UGravitySourceSubsystem>())
+	{
+		GravitySources->RegisterSource(this, GetStaticMeshComponent(), EGravitySourceShape::Sphere);
+	}
+}
+
+void AGravitySphere::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if(UGravitySourceSubsystem* GravitySources = GetWorld()->GetSubsystem<UGravitySourceSubsystem>())
+	{
+		GravitySources->UnregisterSource(this);
+	}
+	Super::EndPlay(EndPlayReason);
 }
 
 void AGravitySphere::BeginPlayAddSphereLevel()
@@ -49,5 +64,7 @@ void AGravitySphere::AddSphereLevel(UPrimitiveComponent* OverlappedComponent, AA
 	}
 }
 
-
-
+float AGravitySphere::GetGravityRadius() const
+{
+	return OverlapSphere ? OverlapSphere->GetScaledSphereRadius() : 0.f;
+}
@@ -18,6 +18,7 @@ public:
 
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	
 	UPROPERTY(EditAnywhere)
 	USphereComponent* OverlapSphere;
@@ -31,6 +32,6 @@ protected:
 private:
 	
 public:	
-
+	float GetGravityRadius() const;
 
 };
@@ -0,0 +1,145 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityLoadSubsystem.h"
+
+#include "EngineUtils.h"
+#include "GameFramework/GameModeBase.h"
+#include "HAL/IConsoleManager.h"
+#include "Gravity/Gravity.h"
+#include "Gravity/Characters/BasePawnPlayer.h"
+#include "Gravity/PlayerController/ShooterBotController.h"
+
+static TAutoConsoleVariable<float> CVarLoadReportInterval(
+	TEXT("Gravity.LoadReportInterval"),
+	0.f,
+	TEXT("Seconds between server tick time against player count reports, 0 turns them off."));
+
+namespace GravityLoad
+{
+	void SpawnBots(const TArray<FString>& Args, UWorld* World)
+	{
+		UGravityLoadSubsystem* Load = World ? World->GetSubsystem<UGravityLoadSubsystem>() : nullptr;
+		if(Load == nullptr || World->GetAuthGameMode() == nullptr)
+		{
+			UE_LOG(LogGravity, Warning, TEXT("Gravity.SpawnBots only runs on the server"));
+			return;
+		}
+		Load->SpawnBots(Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 1);
+	}
+
+	void RemoveBots(const TArray<FString>& Args, UWorld* World)
+	{
+		if(UGravityLoadSubsystem* Load = World ? World->GetSubsystem<UGravityLoadSubsystem>() : nullptr)
+		{
+			Load->RemoveBots();
+		}
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs SpawnBotsCommand(
+	TEXT("Gravity.SpawnBots"),
+	TEXT("Gravity.SpawnBots <Count>, adds bot players on the server."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&GravityLoad::SpawnBots));
+
+static FAutoConsoleCommandWithWorldAndArgs RemoveBotsCommand(
+	TEXT("Gravity.RemoveBots"),
+	TEXT("Removes every bot Gravity.SpawnBots added."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&GravityLoad::RemoveBots));
+
+bool UGravityLoadSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UGravityLoadSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	TickStartHandle = FWorldDelegates::OnWorldTickStart.AddUObject(this, &UGravityLoadSubsystem::OnWorldTickStart);
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UGravityLoadSubsystem::OnWorldPostActorTick);
+}
+
+void UGravityLoadSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldTickStart.Remove(TickStartHandle);
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	Super::Deinitialize();
+}
+
+void UGravityLoadSubsystem::SpawnBots(const int32 Count)
+{
+	AGameModeBase* GameMode = GetWorld()->GetAuthGameMode();
+	for(int32 BotIndex = 0; BotIndex < Count; BotIndex++)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		AShooterBotController* Bot = GetWorld()->SpawnActor<AShooterBotController>(SpawnParams);
+		if(Bot == nullptr)
+		{
+			continue;
+		}
+		//same spawn and possess a joining player goes through
+		GameMode->RestartPlayer(Bot);
+		Bots.Add(Bot);
+	}
+	UE_LOG(LogGravity, Display, TEXT("%d bots running"), Bots.Num());
+}
+
+void UGravityLoadSubsystem::RemoveBots()
+{
+	for(const TWeakObjectPtr<AShooterBotController>& BotPtr : Bots)
+	{
+		if(AShooterBotController* Bot = BotPtr.Get())
+		{
+			if(APawn* BotPawn = Bot->GetPawn())
+			{
+				BotPawn->Destroy();
+			}
+			Bot->Destroy();
+		}
+	}
+	Bots.Reset();
+}
+
+void UGravityLoadSubsystem::OnWorldTickStart(UWorld* TickedWorld, ELevelTick TickType, float DeltaTime)
+{
+	if(TickedWorld == GetWorld())
+	{
+		TickStartTime = FPlatformTime::Seconds();
+	}
+}
+
+void UGravityLoadSubsystem::OnWorldPostActorTick(UWorld* TickedWorld, ELevelTick TickType, float DeltaTime)
+{
+	const float ReportInterval = CVarLoadReportInterval.GetValueOnGameThread();
+	if(TickedWorld != GetWorld() || ReportInterval <= 0.f || TickStartTime == 0.0)
+	{
+		return;
+	}
+	//start of the world tick to after every actor ticked, which is where the movement and gravity cost lands
+	const double TickTime = FPlatformTime::Seconds() - TickStartTime;
+	TickTimeThisWindow += TickTime;
+	PeakTickTimeThisWindow = FMath::Max(PeakTickTimeThisWindow, TickTime);
+	TicksThisWindow++;
+	ReportWindowTime += DeltaTime;
+	if(ReportWindowTime >= ReportInterval)
+	{
+		Report();
+	}
+}
+
+void UGravityLoadSubsystem::Report()
+{
+	int32 NumPawns = 0;
+	for(TActorIterator<ABasePawnPlayer> PawnIt(GetWorld()); PawnIt; ++PawnIt)
+	{
+		NumPawns++;
+	}
+	const double MeanTickMs = TicksThisWindow > 0 ? TickTimeThisWindow * 1000.0 / TicksThisWindow : 0.0;
+	UE_LOG(LogGravity, Display, TEXT("Gravity load: %d players (%d bots), server tick mean %.2f ms, peak %.2f ms over %d ticks"),
+		NumPawns, Bots.Num(), MeanTickMs, PeakTickTimeThisWindow * 1000.0, TicksThisWindow);
+	ReportWindowTime = 0.0;
+	TickTimeThisWindow = 0.0;
+	PeakTickTimeThisWindow = 0.0;
+	TicksThisWindow = 0;
+}
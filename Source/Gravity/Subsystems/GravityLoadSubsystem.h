@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "GravityLoadSubsystem.generated.h"
+
+class AShooterBotController;
+
+/**
+ * Capacity testing on a server. Gravity.SpawnBots adds bot players, and while Gravity.LoadReportInterval is above 0
+ * the server logs its world tick time against how many pawns it's running.
+ * Real clients can join as bots too by starting with -nullrhi -GravityBot.
+ */
+UCLASS()
+class GRAVITY_API UGravityLoadSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	void SpawnBots(int32 Count);
+	void RemoveBots();
+
+private:
+	void OnWorldTickStart(UWorld* TickedWorld, ELevelTick TickType, float DeltaTime);
+	void OnWorldPostActorTick(UWorld* TickedWorld, ELevelTick TickType, float DeltaTime);
+	void Report();
+
+	TArray<TWeakObjectPtr<AShooterBotController>> Bots;
+	FDelegateHandle TickStartHandle;
+	FDelegateHandle PostActorTickHandle;
+	double TickStartTime = 0.0;
+	double ReportWindowTime = 0.0;
+	double TickTimeThisWindow = 0.0;
+	double PeakTickTimeThisWindow = 0.0;
+	int32 TicksThisWindow = 0;
+};
@@ -0,0 +1,263 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityProjectileSubsystem.h"
+
+#include "Async/ParallelFor.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/Pawn.h"
+#include "Gravity/GravityStats.h"
+#include "Gravity/Characters/BasePawnPlayer.h"
+#include "Gravity/Movement/ShooterWorldQuery.h"
+#include "Gravity/Subsystems/GravitySourceSubsystem.h"
+#include "Kismet/GameplayStatics.h"
+
+bool UGravityProjectileSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UGravityProjectileSubsystem::Deinitialize()
+{
+	if(VisualsActor)
+	{
+		VisualsActor->Destroy();
+		VisualsActor = nullptr;
+	}
+	Super::Deinitialize();
+}
+
+TStatId UGravityProjectileSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UGravityProjectileSubsystem, STATGROUP_Tickables);
+}
+
+void UGravityProjectileSubsystem::LaunchProjectile(const FGravityProjectileParams& Params, const FVector& Origin, const FVector& Direction, AActor* Shooter, const bool bDealsDamage)
+{
+	Positions.Add(Origin);
+	Velocities.Add(Direction.GetSafeNormal() * Params.Speed);
+	GravityPulls.Add(FVector::ZeroVector);
+	TimesRemaining.Add(Params.Lifetime);
+	Damages.Add(Params.Damage);
+	GravityStrengths.Add(Params.bAffectedByGravity ? Params.GravityStrength : 0.f);
+	GravityRadii.Add(Params.GravityDistanceRadius);
+	TraceChannels.Add(Params.TraceChannel);
+	Shooters.Add(Shooter);
+	MeshIndices.Add(FindOrAddMesh(Params.Mesh));
+	DealsDamage.Add(bDealsDamage && GetWorld()->GetNetMode() != NM_Client);
+}
+
+void UGravityProjectileSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	GRAVITY_SCOPE_CYCLE_COUNTER(STAT_GravityProjectiles);
+	if(Positions.Num() > 0)
+	{
+		StepProjectiles(DeltaTime);
+		ApplyHitsAndExpire();
+	}
+	SET_DWORD_STAT(STAT_GravityProjectilesInFlight, Positions.Num());
+	UpdateVisuals();
+	FrameCount++;
+}
+
+void UGravityProjectileSubsystem::GatherPawnHitboxes()
+{
+	PawnHitboxes.Reset();
+	HitboxPawns.Reset();
+	HitboxPawnIndices.Reset();
+	if(!DealsDamage.Contains(true))
+	{
+		return;
+	}
+	//kept in world space, projectiles are spread over the whole level
+	FShooterHitboxFrame Frame;
+	for(TActorIterator<ABasePawnPlayer> It(GetWorld()); It; ++It)
+	{
+		//projectiles fly in the present, the newest frame is where the pawn is now
+		if(It->GetRewoundHitboxes(It->GetServerWorldTime(), Frame))
+		{
+			const int32 PawnIndex = HitboxPawns.Add(*It);
+			HitboxPawnIndices.Add(*It, PawnIndex);
+			PawnHitboxes.AddFrame(Frame, PawnIndex);
+		}
+	}
+}
+
+void UGravityProjectileSubsystem::StepProjectiles(const float DeltaTime)
+{
+	const UWorld* World = GetWorld();
+	const int32 NumProjectiles = Positions.Num();
+	Hits.SetNum(NumProjectiles, false);
+	HitThisFrame.SetNum(NumProjectiles, false);
+	HitPawns.SetNum(NumProjectiles, false);
+	GatherPawnHitboxes();
+	//weak pointers are resolved here, not on the workers
+	IgnoredActors.SetNum(NumProjectiles, false);
+	IgnoredHitboxOwners.SetNum(NumProjectiles, false);
+	for(int32 Index = 0; Index < NumProjectiles; Index++)
+	{
+		IgnoredActors[Index] = Shooters[Index].Get();
+		const int32* ShooterPawnIndex = HitboxPawnIndices.Find(IgnoredActors[Index]);
+		IgnoredHitboxOwners[Index] = ShooterPawnIndex ? *ShooterPawnIndex : INDEX_NONE;
+	}
+	//pawns are found through their hit boxes, the physics scene only has to find the level
+	FCollisionResponseParams HitboxResponse;
+	HitboxResponse.CollisionResponse.SetResponse(ECC_Pawn, ECR_Ignore);
+	//the source tree rebuilds lazily, that can't happen on the workers
+	if(const UGravitySourceSubsystem* GravitySources = World->GetSubsystem<UGravitySourceSubsystem>())
+	{
+		GravitySources->PrepareForQueries();
+	}
+	const uint32 GravityRefreshSlot = FrameCount % GravityRefreshFrames;
+	ParallelFor(NumProjectiles, [this, World, DeltaTime, GravityRefreshSlot, &HitboxResponse](const int32 Index)
+	{
+		if(GravityStrengths[Index] > 0.f && static_cast<uint32>(Index) % GravityRefreshFrames == GravityRefreshSlot)
+		{
+			//the same closest floor a pawn here would fall toward, nothing is drawn or logged off the game thread
+			const FShooterWorldQuery WorldQuery(World, nullptr, GravityRadii[Index], 0.f);
+			FShooterFloorQueryResult FloorResult;
+			GravityPulls[Index] = WorldQuery.FindClosestFloor(Positions[Index], FLT_MAX, FloorResult) ?
+				(FVector(FloorResult.FloorHitResult.ImpactPoint) - Positions[Index]).GetSafeNormal() * GravityStrengths[Index] :
+				FVector::ZeroVector;
+		}
+		Velocities[Index] += GravityPulls[Index] * DeltaTime;
+		const FVector SegmentEnd = Positions[Index] + Velocities[Index] * DeltaTime;
+		const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(GravityProjectile), false, IgnoredActors[Index]);
+		HitThisFrame[Index] = World->LineTraceSingleByChannel(Hits[Index], Positions[Index], SegmentEnd, TraceChannels[Index], QueryParams,
+			DealsDamage[Index] ? HitboxResponse : FCollisionResponseParams::DefaultResponseParam);
+		HitPawns[Index] = nullptr;
+		FVector NewPosition = HitThisFrame[Index] ? FVector(Hits[Index].ImpactPoint) : SegmentEnd;
+		if(DealsDamage[Index] && PawnHitboxes.Num() > 0)
+		{
+			const FVector Segment = NewPosition - Positions[Index];
+			const float SegmentLength = static_cast<float>(Segment.Size());
+			FShooterHitboxRayHit BoxHit;
+			if(SegmentLength > 0.f && PawnHitboxes.RaycastClosest(Positions[Index], Segment / SegmentLength, SegmentLength, BoxHit, IgnoredHitboxOwners[Index]))
+			{
+				HitThisFrame[Index] = true;
+				HitPawns[Index] = HitboxPawns[BoxHit.Owner];
+				NewPosition = Positions[Index] + Segment / SegmentLength * BoxHit.Distance;
+			}
+		}
+		Positions[Index] = NewPosition;
+		TimesRemaining[Index] -= DeltaTime;
+	}, NumProjectiles < MinParallelBatchSize ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+}
+
+void UGravityProjectileSubsystem::ApplyHitsAndExpire()
+{
+	//backwards so removing by swap never skips a projectile
+	for(int32 Index = Positions.Num() - 1; Index >= 0; Index--)
+	{
+		if(HitThisFrame[Index])
+		{
+			AActor* HitActor = HitPawns[Index] ? HitPawns[Index] : Hits[Index].GetActor();
+			if(DealsDamage[Index] && Cast<ABasePawnPlayer>(HitActor))
+			{
+				AActor* Shooter = Shooters[Index].Get();
+				const APawn* ShooterPawn = Cast<APawn>(Shooter);
+				UGameplayStatics::ApplyDamage(HitActor, Damages[Index], ShooterPawn ? ShooterPawn->GetController() : nullptr, Shooter, UDamageType::StaticClass());
+			}
+			RemoveProjectile(Index);
+		}
+		else if(TimesRemaining[Index] <= 0.f)
+		{
+			RemoveProjectile(Index);
+		}
+	}
+}
+
+void UGravityProjectileSubsystem::RemoveProjectile(const int32 Index)
+{
+	Positions.RemoveAtSwap(Index, 1, false);
+	Velocities.RemoveAtSwap(Index, 1, false);
+	GravityPulls.RemoveAtSwap(Index, 1, false);
+	TimesRemaining.RemoveAtSwap(Index, 1, false);
+	Damages.RemoveAtSwap(Index, 1, false);
+	GravityStrengths.RemoveAtSwap(Index, 1, false);
+	GravityRadii.RemoveAtSwap(Index, 1, false);
+	TraceChannels.RemoveAtSwap(Index, 1, false);
+	Shooters.RemoveAtSwap(Index, 1, false);
+	MeshIndices.RemoveAtSwap(Index, 1, false);
+	DealsDamage.RemoveAtSwap(Index, 1, false);
+	Hits.RemoveAtSwap(Index, 1, false);
+	HitThisFrame.RemoveAtSwap(Index, 1, false);
+	HitPawns.RemoveAtSwap(Index, 1, false);
+}
+
+int32 UGravityProjectileSubsystem::FindOrAddMesh(UStaticMesh* Mesh)
+{
+	if(Mesh == nullptr || GetWorld()->GetNetMode() == NM_DedicatedServer)
+	{
+		return INDEX_NONE;
+	}
+	const int32 ExistingIndex = Meshes.Find(Mesh);
+	if(ExistingIndex != INDEX_NONE)
+	{
+		return ExistingIndex;
+	}
+	if(VisualsActor == nullptr)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.ObjectFlags |= RF_Transient;
+		VisualsActor = GetWorld()->SpawnActor<AActor>(SpawnParams);
+		VisualsActor->SetRootComponent(NewObject<USceneComponent>(VisualsActor, TEXT("Root")));
+		VisualsActor->GetRootComponent()->RegisterComponent();
+	}
+	UInstancedStaticMeshComponent* Instances = NewObject<UInstancedStaticMeshComponent>(VisualsActor);
+	Instances->SetStaticMesh(Mesh);
+	Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Instances->SetCastShadow(false);
+	Instances->SetupAttachment(VisualsActor->GetRootComponent());
+	Instances->RegisterComponent();
+	Meshes.Add(Mesh);
+	MeshInstances.Add(Instances);
+	InstanceTransforms.AddDefaulted();
+	return Meshes.Num() - 1;
+}
+
+void UGravityProjectileSubsystem::UpdateVisuals()
+{
+	if(MeshInstances.Num() == 0)
+	{
+		return;
+	}
+	for(TArray<FTransform>& Transforms : InstanceTransforms)
+	{
+		Transforms.Reset();
+	}
+	for(int32 Index = 0; Index < Positions.Num(); Index++)
+	{
+		if(MeshIndices[Index] != INDEX_NONE)
+		{
+			InstanceTransforms[MeshIndices[Index]].Emplace(Velocities[Index].Rotation(), Positions[Index]);
+		}
+	}
+	//instances are only added or dropped at the end, everything else is rewritten in one batch
+	for(int32 MeshIndex = 0; MeshIndex < MeshInstances.Num(); MeshIndex++)
+	{
+		UInstancedStaticMeshComponent* Instances = MeshInstances[MeshIndex];
+		const TArray<FTransform>& Transforms = InstanceTransforms[MeshIndex];
+		const int32 NumInstances = Instances->GetInstanceCount();
+		if(NumInstances > Transforms.Num())
+		{
+			TArray<int32> InstancesToRemove;
+			for(int32 InstanceIndex = NumInstances - 1; InstanceIndex >= Transforms.Num(); InstanceIndex--)
+			{
+				InstancesToRemove.Add(InstanceIndex);
+			}
+			Instances->RemoveInstances(InstancesToRemove);
+		}
+		else if(NumInstances < Transforms.Num())
+		{
+			Instances->AddInstances(TArray<FTransform>(Transforms.GetData() + NumInstances, Transforms.Num() - NumInstances), false, true);
+		}
+		if(Transforms.Num() > 0)
+		{
+			Instances->BatchUpdateInstancesTransforms(0, Transforms, true, true);
+		}
+	}
+}
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Gravity/GravityTypes/GravityProjectileTypes.h"
+#include "Gravity/Weapons/ShooterHitboxBatch.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "GravityProjectileSubsystem.generated.h"
+
+class UInstancedStaticMeshComponent;
+
+/**
+ * Every projectile in flight, kept as parallel arrays and stepped in one batch per frame instead of as actors.
+ * Each frame the projectiles are integrated and swept along their segment in parallel, then hits are applied on the game thread.
+ * Only projectiles launched with damage on the server can hurt anyone, the rest are what clients see.
+ * Those find pawns through the pawns' hit boxes rather than the physics scene.
+ */
+UCLASS()
+class GRAVITY_API UGravityProjectileSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void LaunchProjectile(const FGravityProjectileParams& Params, const FVector& Origin, const FVector& Direction, AActor* Shooter, bool bDealsDamage);
+	FORCEINLINE int32 Num() const { return Positions.Num(); }
+
+private:
+	void GatherPawnHitboxes();
+	void StepProjectiles(float DeltaTime);
+	void ApplyHitsAndExpire();
+	void RemoveProjectile(int32 Index);
+	void UpdateVisuals();
+	int32 FindOrAddMesh(UStaticMesh* Mesh);
+
+	//batches smaller than this aren't worth waking the task graph for
+	static constexpr int32 MinParallelBatchSize = 64;
+	//each projectile looks for its closest floor once every this many frames and keeps that pull in between
+	static constexpr int32 GravityRefreshFrames = 4;
+
+	TArray<FVector> Positions;
+	TArray<FVector> Velocities;
+	TArray<FVector> GravityPulls;
+	TArray<float> TimesRemaining;
+	TArray<float> Damages;
+	TArray<float> GravityStrengths;
+	TArray<float> GravityRadii;
+	TArray<TEnumAsByte<ECollisionChannel>> TraceChannels;
+	TArray<TWeakObjectPtr<AActor>> Shooters;
+	TArray<int32> MeshIndices;
+	TArray<bool> DealsDamage;
+
+	//filled by the parallel step, read back on the game thread
+	TArray<FHitResult> Hits;
+	TArray<bool> HitThisFrame;
+	TArray<const AActor*> IgnoredActors;
+	TArray<int32> IgnoredHitboxOwners;
+	TArray<AActor*> HitPawns;
+
+	//every pawn's newest hit boxes, rebuilt each frame something that deals damage is in flight
+	FShooterHitboxBatch PawnHitboxes;
+	TArray<AActor*> HitboxPawns;
+	TMap<const AActor*, int32> HitboxPawnIndices;
+
+	uint32 FrameCount = 0;
+
+	//one instanced mesh per projectile mesh, nothing is drawn on a dedicated server
+	UPROPERTY()
+	AActor* VisualsActor = nullptr;
+	UPROPERTY()
+	TArray<UStaticMesh*> Meshes;
+	UPROPERTY()
+	TArray<UInstancedStaticMeshComponent*> MeshInstances;
+	TArray<TArray<FTransform>> InstanceTransforms;
+};
@@ -0,0 +1,122 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityQuerySubsystem.h"
+
+#include "Async/ParallelFor.h"
+#include "GameFramework/Actor.h"
+#include "Gravity/GravityStats.h"
+#include "Gravity/Characters/BasePawnPlayer.h"
+#include "Gravity/Subsystems/GravitySourceSubsystem.h"
+
+bool UGravityQuerySubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UGravityQuerySubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	RunServerMoves();
+	RunBatch();
+}
+
+TStatId UGravityQuerySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UGravityQuerySubsystem, STATGROUP_Tickables);
+}
+
+void UGravityQuerySubsystem::QueueQuery(const FGravityQueryRequest& Request)
+{
+	const TObjectKey<AActor> RequesterKey(Request.Requester.Get());
+	if(const int32* PendingIndex = PendingRequestIndices.Find(RequesterKey))
+	{
+		PendingRequests[*PendingIndex] = Request;
+		return;
+	}
+	PendingRequestIndices.Add(RequesterKey, PendingRequests.Add(Request));
+}
+
+bool UGravityQuerySubsystem::ConsumeResponse(const AActor* Requester, FGravityQueryResponse& OutResponse)
+{
+	return Responses.RemoveAndCopyValue(TObjectKey<AActor>(Requester), OutResponse);
+}
+
+void UGravityQuerySubsystem::QueueServerMoves(ABasePawnPlayer* Pawn)
+{
+	PawnsWithServerMoves.AddUnique(Pawn);
+}
+
+void UGravityQuerySubsystem::RunServerMoves()
+{
+	if(PawnsWithServerMoves.Num() == 0)
+	{
+		return;
+	}
+	GRAVITY_SCOPE_CYCLE_COUNTER(STAT_GravityServerMoves);
+	ServerMovePawns.Reset();
+	for(const TWeakObjectPtr<ABasePawnPlayer>& Pawn : PawnsWithServerMoves)
+	{
+		if(Pawn.IsValid())
+		{
+			ServerMovePawns.Add(Pawn.Get());
+		}
+	}
+	PawnsWithServerMoves.Reset();
+	//the source tree rebuilds lazily, that can't happen on the workers
+	if(const UGravitySourceSubsystem* GravitySources = GetWorld()->GetSubsystem<UGravitySourceSubsystem>())
+	{
+		GravitySources->PrepareForQueries();
+	}
+	//each pawn's moves depend on each other, the pawns don't
+	ParallelFor(ServerMovePawns.Num(), [this](const int32 PawnIndex)
+	{
+		ServerMovePawns[PawnIndex]->StepQueuedServerMoves();
+	}, ServerMovePawns.Num() < MinParallelBatchSize ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+	for(ABasePawnPlayer* Pawn : ServerMovePawns)
+	{
+		Pawn->FinishQueuedServerMoves();
+	}
+}
+
+void UGravityQuerySubsystem::RunBatch()
+{
+	if(PendingRequests.Num() == 0)
+	{
+		return;
+	}
+	//answers nobody came back for belong to actors that are gone
+	for(auto It = Responses.CreateIterator(); It; ++It)
+	{
+		if(It.Key().ResolveObjectPtr() == nullptr)
+		{
+			It.RemoveCurrent();
+		}
+	}
+	//the source tree rebuilds lazily, that can't happen on the workers
+	if(const UGravitySourceSubsystem* GravitySources = GetWorld()->GetSubsystem<UGravitySourceSubsystem>())
+	{
+		GravitySources->PrepareForQueries();
+	}
+
+	TArray<FGravityQueryResponse> BatchResponses;
+	BatchResponses.SetNum(PendingRequests.Num());
+	const UWorld* World = GetWorld();
+	ParallelFor(PendingRequests.Num(), [this, World, &BatchResponses](const int32 RequestIndex)
+	{
+		const FGravityQueryRequest& Request = PendingRequests[RequestIndex];
+		FGravityQueryResponse& Response = BatchResponses[RequestIndex];
+		Response.Location = Request.Location;
+		//never draws, debug drawing isn't safe off the game thread
+		const FShooterWorldQuery WorldQuery(World, Request.GravityLevelSphere.Get(), Request.GravityDistanceRadius, Request.SphereTraceRadius);
+		Response.bFoundFloor = WorldQuery.FindClosestFloor(Request.Location, FLT_MAX, Response.Result);
+	}, PendingRequests.Num() < MinParallelBatchSize ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+
+	for(int32 RequestIndex = 0; RequestIndex < PendingRequests.Num(); RequestIndex++)
+	{
+		//replaces an answer the requester never took
+		Responses.Add(TObjectKey<AActor>(PendingRequests[RequestIndex].Requester.Get()), MoveTemp(BatchResponses[RequestIndex]));
+	}
+	PendingRequests.Reset();
+	PendingRequestIndices.Reset();
+}
@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Gravity/Movement/ShooterWorldQuery.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "GravityQuerySubsystem.generated.h"
+
+class ABasePawnPlayer;
+
+struct FGravityQueryRequest
+{
+	TWeakObjectPtr<const AActor> Requester;
+	TWeakObjectPtr<const AActor> GravityLevelSphere;
+	FVector Location = FVector::ZeroVector;
+	float GravityDistanceRadius = 0.f;
+	float SphereTraceRadius = 0.f;
+};
+
+struct FGravityQueryResponse
+{
+	FVector Location = FVector::ZeroVector;
+	bool bFoundFloor = false;
+	FShooterFloorQueryResult Result;
+};
+
+/**
+ * Closest floor queries from every airborne pawn, gathered during the frame and run as one parallel batch at the end of it.
+ * A pawn reads its answer on its next step, so nobody waits on a scene query in their own tick.
+ * Answers are kept until that step takes them, frames without a fixed step don't lose them.
+ * On the server the moves clients sent during the frame are stepped here too, every pawn's in parallel.
+ */
+UCLASS()
+class GRAVITY_API UGravityQuerySubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	//a newer request from the same actor replaces the older one
+	void QueueQuery(const FGravityQueryRequest& Request);
+	//hands over the newest answer for Requester, each answer is only read once
+	bool ConsumeResponse(const AActor* Requester, FGravityQueryResponse& OutResponse);
+
+	//the pawn has client moves waiting, they're stepped with everyone else's at the end of the frame
+	void QueueServerMoves(ABasePawnPlayer* Pawn);
+
+private:
+	void RunBatch();
+	void RunServerMoves();
+
+	//batches smaller than this aren't worth waking the task graph for
+	static constexpr int32 MinParallelBatchSize = 8;
+
+	TArray<FGravityQueryRequest> PendingRequests;
+	TMap<TObjectKey<AActor>, int32> PendingRequestIndices;
+	TMap<TObjectKey<AActor>, FGravityQueryResponse> Responses;
+
+	TArray<TWeakObjectPtr<ABasePawnPlayer>> PawnsWithServerMoves;
+	TArray<ABasePawnPlayer*> ServerMovePawns;
+};
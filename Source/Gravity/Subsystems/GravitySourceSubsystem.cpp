@@ -0,0 +1,258 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravitySourceSubsystem.h"
+
+#include "Components/PrimitiveComponent.h"
+#include "GameFramework/Actor.h"
+#include "Engine/World.h"
+#include "Gravity/GravityField/GravityFieldVolume.h"
+
+bool UGravitySourceSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UGravitySourceSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	PreActorTickHandle = FWorldDelegates::OnWorldPreActorTick.AddUObject(this, &UGravitySourceSubsystem::OnWorldPreActorTick);
+}
+
+void UGravitySourceSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldPreActorTick.Remove(PreActorTickHandle);
+	Super::Deinitialize();
+}
+
+void UGravitySourceSubsystem::OnWorldPreActorTick(UWorld* TickedWorld, ELevelTick TickType, float DeltaTime)
+{
+	if(TickedWorld != GetWorld())
+	{
+		return;
+	}
+	if(bTreeDirty)
+	{
+		RebuildTree();
+	}
+	else if(NumDynamicSources > 0)
+	{
+		RefitDynamicSources();
+	}
+}
+
+void UGravitySourceSubsystem::RegisterSource(AActor* SourceActor, UPrimitiveComponent* SourceComponent, const EGravitySourceShape Shape)
+{
+	if(SourceActor == nullptr || SourceComponent == nullptr)
+	{
+		return;
+	}
+	if(SourceComponent->GetCollisionResponseToChannel(ECC_GameTraceChannel1) == ECR_Ignore)
+	{
+		return;
+	}
+	FGravitySource& Source = Sources.AddDefaulted_GetRef();
+	Source.Actor = SourceActor;
+	Source.Component = SourceComponent;
+	Source.Shape = Shape;
+	Source.bDynamic = SourceComponent->Mobility == EComponentMobility::Movable;
+	NumDynamicSources += Source.bDynamic ? 1 : 0;
+	bTreeDirty = true;
+}
+
+void UGravitySourceSubsystem::UnregisterSource(const AActor* SourceActor)
+{
+	const int32 NumRemoved = Sources.RemoveAllSwap([this, SourceActor](const FGravitySource& Source)
+	{
+		if(Source.Actor != SourceActor)
+		{
+			return false;
+		}
+		NumDynamicSources -= Source.bDynamic ? 1 : 0;
+		return true;
+	});
+	bTreeDirty |= NumRemoved > 0;
+}
+
+void UGravitySourceSubsystem::RegisterField(AGravityFieldVolume* Field)
+{
+	if(Field && Field->IsBaked())
+	{
+		Fields.AddUnique(Field);
+	}
+}
+
+void UGravitySourceSubsystem::UnregisterField(const AGravityFieldVolume* Field)
+{
+	Fields.RemoveAllSwap([Field](const TWeakObjectPtr<AGravityFieldVolume>& RegisteredField) { return RegisteredField == Field; });
+}
+
+const AGravityFieldVolume* UGravitySourceSubsystem::FindField(const FVector& Location) const
+{
+	if(NumDynamicSources > 0)
+	{
+		return nullptr;
+	}
+	for(const TWeakObjectPtr<AGravityFieldVolume>& Field : Fields)
+	{
+		if(Field.IsValid() && Field->Covers(Location))
+		{
+			return Field.Get();
+		}
+	}
+	return nullptr;
+}
+
+void UGravitySourceSubsystem::FindSourcesInRange(const FVector& Location, const float Radius, FGravitySourceList& OutSourceIndices) const
+{
+	if(bTreeDirty)
+	{
+		RebuildTree();
+	}
+	if(TreeNodes.Num() == 0)
+	{
+		return;
+	}
+	const float RadiusSquared = FMath::Square(Radius);
+	TArray<int32, TInlineAllocator<32>> NodeStack;
+	NodeStack.Add(0);
+	while(NodeStack.Num() > 0)
+	{
+		const FTreeNode& Node = TreeNodes[NodeStack.Pop(false)];
+		if(Node.Bounds.ComputeSquaredDistanceToPoint(Location) > RadiusSquared)
+		{
+			continue;
+		}
+		if(Node.Left != INDEX_NONE)
+		{
+			NodeStack.Add(Node.Left);
+			NodeStack.Add(Node.Right);
+			continue;
+		}
+		for(int32 SortedIndex = Node.FirstSource; SortedIndex < Node.FirstSource + Node.NumSources; SortedIndex++)
+		{
+			const int32 SourceIndex = SortedSources[SortedIndex];
+			if(SourceBounds[SourceIndex].ComputeSquaredDistanceToPoint(Location) <= RadiusSquared)
+			{
+				OutSourceIndices.Add(SourceIndex);
+			}
+		}
+	}
+}
+
+const FGravitySource* UGravitySourceSubsystem::FindSource(const AActor* SourceActor) const
+{
+	if(bTreeDirty)
+	{
+		RebuildTree();
+	}
+	const int32* SourceIndex = SourceIndices.Find(TObjectKey<AActor>(SourceActor));
+	return SourceIndex ? &Sources[*SourceIndex] : nullptr;
+}
+
+void UGravitySourceSubsystem::RebuildTree() const
+{
+	bTreeDirty = false;
+	TreeNodes.Reset();
+	SortedSources.Reset();
+	SourceIndices.Reset();
+	SourceBounds.SetNum(Sources.Num());
+	for(int32 SourceIndex = 0; SourceIndex < Sources.Num(); SourceIndex++)
+	{
+		const UPrimitiveComponent* Component = Sources[SourceIndex].Component.Get();
+		if(Component == nullptr)
+		{
+			continue;
+		}
+		SourceBounds[SourceIndex] = Component->Bounds.GetBox();
+		UpdateSourceShape(Sources[SourceIndex]);
+		SortedSources.Add(SourceIndex);
+		SourceIndices.FindOrAdd(TObjectKey<AActor>(Sources[SourceIndex].Actor.Get()), SourceIndex);
+	}
+	if(SortedSources.Num() > 0)
+	{
+		BuildNode(0, SortedSources.Num());
+	}
+}
+
+void UGravitySourceSubsystem::UpdateSourceShape(FGravitySource& Source)
+{
+	const UPrimitiveComponent* Component = Source.Component.Get();
+	if(Component == nullptr || Source.Shape == EGravitySourceShape::Mesh)
+	{
+		return;
+	}
+	//local bounds of a sphere or box mesh are the shape itself
+	const FBoxSphereBounds LocalBounds = Component->CalcBounds(FTransform::Identity);
+	const FTransform& ComponentTransform = Component->GetComponentTransform();
+	const FVector Scale = ComponentTransform.GetScale3D().GetAbs();
+	Source.Center = ComponentTransform.TransformPosition(LocalBounds.Origin);
+	Source.Rotation = ComponentTransform.GetRotation();
+	Source.HalfExtent = LocalBounds.BoxExtent * Scale;
+	//sphere meshes are expected to be scaled uniformly
+	Source.Radius = LocalBounds.BoxExtent.GetMax() * Scale.GetMax();
+}
+
+void UGravitySourceSubsystem::RefitDynamicSources()
+{
+	for(const int32 SourceIndex : SortedSources)
+	{
+		FGravitySource& Source = Sources[SourceIndex];
+		const UPrimitiveComponent* Component = Source.Component.Get();
+		if(Source.bDynamic && Component)
+		{
+			SourceBounds[SourceIndex] = Component->Bounds.GetBox();
+			UpdateSourceShape(Source);
+		}
+	}
+	//children are always built after their parent, so going backwards every child is done before its parent
+	for(int32 NodeIndex = TreeNodes.Num() - 1; NodeIndex >= 0; NodeIndex--)
+	{
+		FTreeNode& Node = TreeNodes[NodeIndex];
+		if(Node.Left != INDEX_NONE)
+		{
+			Node.Bounds = TreeNodes[Node.Left].Bounds + TreeNodes[Node.Right].Bounds;
+			continue;
+		}
+		Node.Bounds = FBox(ForceInit);
+		for(int32 SortedIndex = Node.FirstSource; SortedIndex < Node.FirstSource + Node.NumSources; SortedIndex++)
+		{
+			Node.Bounds += SourceBounds[SortedSources[SortedIndex]];
+		}
+	}
+}
+
+int32 UGravitySourceSubsystem::BuildNode(const int32 FirstSource, const int32 NumSources) const
+{
+	const int32 NodeIndex = TreeNodes.AddDefaulted();
+	FBox NodeBounds(ForceInit);
+	FBox CenterBounds(ForceInit);
+	for(int32 SortedIndex = FirstSource; SortedIndex < FirstSource + NumSources; SortedIndex++)
+	{
+		const FBox& Bounds = SourceBounds[SortedSources[SortedIndex]];
+		NodeBounds += Bounds;
+		CenterBounds += Bounds.GetCenter();
+	}
+	TreeNodes[NodeIndex].Bounds = NodeBounds;
+	if(NumSources <= MaxSourcesPerLeaf)
+	{
+		TreeNodes[NodeIndex].FirstSource = FirstSource;
+		TreeNodes[NodeIndex].NumSources = NumSources;
+		return NodeIndex;
+	}
+
+	//median split along the axis the centers are most spread on
+	const FVector CenterExtent = CenterBounds.GetExtent();
+	const int32 SplitAxis = CenterExtent.X >= CenterExtent.Y && CenterExtent.X >= CenterExtent.Z ? 0 : (CenterExtent.Y >= CenterExtent.Z ? 1 : 2);
+	TArrayView<int32> NodeSources(SortedSources.GetData() + FirstSource, NumSources);
+	NodeSources.Sort([this, SplitAxis](const int32 A, const int32 B)
+	{
+		return SourceBounds[A].GetCenter()[SplitAxis] < SourceBounds[B].GetCenter()[SplitAxis];
+	});
+	const int32 NumLeft = NumSources / 2;
+	const int32 Left = BuildNode(FirstSource, NumLeft);
+	const int32 Right = BuildNode(FirstSource + NumLeft, NumSources - NumLeft);
+	TreeNodes[NodeIndex].Left = Left;
+	TreeNodes[NodeIndex].Right = Right;
+	return NodeIndex;
+}
@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Gravity/GravityTypes/GravitySourceShape.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "GravitySourceSubsystem.generated.h"
+
+class AGravityFieldVolume;
+class UPrimitiveComponent;
+
+struct FGravitySource
+{
+	TWeakObjectPtr<AActor> Actor;
+	TWeakObjectPtr<UPrimitiveComponent> Component;
+	EGravitySourceShape Shape = EGravitySourceShape::Mesh;
+	//movable sources make any baked field stale, their bounds and shape are refreshed every frame
+	bool bDynamic = false;
+
+	//world space shape, refreshed with the tree. Spheres use Radius, boxes use Rotation and HalfExtent
+	FVector Center = FVector::ZeroVector;
+	FQuat Rotation = FQuat::Identity;
+	FVector HalfExtent = FVector::ZeroVector;
+	float Radius = 0.f;
+};
+
+using FGravitySourceList = TArray<int32, TInlineAllocator<16>>;
+
+/**
+ * Every floor and gravity sphere in the world, kept in a bounding volume hierarchy
+ * so the closest floor query only has to look at the handful of sources near the pawn.
+ * Movable sources are refitted into the hierarchy once a frame, before any actor ticks.
+ */
+UCLASS()
+class GRAVITY_API UGravitySourceSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	//the component is the one the floor query sweeps against, it has to respond to the gravity floor channel
+	void RegisterSource(AActor* SourceActor, UPrimitiveComponent* SourceComponent, EGravitySourceShape Shape = EGravitySourceShape::Mesh);
+	void UnregisterSource(const AActor* SourceActor);
+	//rebuilds the hierarchy from scratch before the next query, movable sources don't need this
+	FORCEINLINE void MarkSourcesMoved() { bTreeDirty = true; }
+
+	//rebuilds the hierarchy now if it's dirty, queries running off the game thread need this done first
+	FORCEINLINE void PrepareForQueries() const { if(bTreeDirty) RebuildTree(); }
+
+	//indices of every source whose bounds touch the sphere
+	void FindSourcesInRange(const FVector& Location, float Radius, FGravitySourceList& OutSourceIndices) const;
+	//the first source registered for the actor, null if it has none
+	const FGravitySource* FindSource(const AActor* SourceActor) const;
+
+	//baked fields are only handed out while every registered source is static
+	void RegisterField(AGravityFieldVolume* Field);
+	void UnregisterField(const AGravityFieldVolume* Field);
+	const AGravityFieldVolume* FindField(const FVector& Location) const;
+
+	FORCEINLINE int32 Num() const { return Sources.Num(); }
+	FORCEINLINE const FGravitySource& GetSource(const int32 SourceIndex) const { return Sources[SourceIndex]; }
+
+private:
+	struct FTreeNode
+	{
+		FBox Bounds = FBox(ForceInit);
+		//children are only set on inner nodes, leaves own a range of SortedSources
+		int32 Left = INDEX_NONE;
+		int32 Right = INDEX_NONE;
+		int32 FirstSource = 0;
+		int32 NumSources = 0;
+	};
+
+	static constexpr int32 MaxSourcesPerLeaf = 4;
+
+	void OnWorldPreActorTick(UWorld* TickedWorld, ELevelTick TickType, float DeltaTime);
+	void RebuildTree() const;
+	//moves the movable sources to where their components are now and grows the nodes above them to fit
+	void RefitDynamicSources();
+	static void UpdateSourceShape(FGravitySource& Source);
+	int32 BuildNode(int32 FirstSource, int32 NumSources) const;
+
+	//shapes are refreshed when a query finds the tree dirty
+	mutable TArray<FGravitySource> Sources;
+	int32 NumDynamicSources = 0;
+
+	TArray<TWeakObjectPtr<AGravityFieldVolume>> Fields;
+
+	//cached from the components when the tree is built so queries don't touch them
+	mutable TArray<FBox> SourceBounds;
+	mutable TArray<FTreeNode> TreeNodes;
+	mutable TArray<int32> SortedSources;
+	mutable TMap<TObjectKey<AActor>, int32> SourceIndices;
+	mutable bool bTreeDirty = false;
+	FDelegateHandle PreActorTickHandle;
+};
@@ -0,0 +1,314 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CoreMinimal.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Gravity/Characters/BasePawnPlayer.h"
+#include "Gravity/Movement/ShooterWorldQuery.h"
+
+#include <atomic>
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * Spawns pawns into a bare game world around one of the floor layouts, drives them with scripted input
+ * and fails when game thread time, floor queries or allocations per tick go over the budgets in DefaultGame.ini.
+ * Runs headless: -nullrhi -unattended -ExecCmds="Automation RunTests Gravity.Perf; Quit"
+ */
+namespace GravityPerfTest
+{
+	const TCHAR* BudgetSection = TEXT("GravityPerfBudgets");
+	const TCHAR* PawnClassPath = TEXT("/Game/Gravity/Blueprints/Characters/BP_BasePawnPlayer.BP_BasePawnPlayer_C");
+	const TCHAR* FloorClassPath = TEXT("/Game/Gravity/Blueprints/Flooring/BP_FloorBase.BP_FloorBase_C");
+	const TCHAR* SphereFloorClassPath = TEXT("/Game/Gravity/Blueprints/Flooring/BP_SphereFloorBase.BP_SphereFloorBase_C");
+	const TCHAR* GravitySphereClassPath = TEXT("/Game/Gravity/Blueprints/Sphere/BP_GravitySphere.BP_GravitySphere_C");
+	const TCHAR* Layouts[] = { TEXT("Floors"), TEXT("SphereFloors"), TEXT("GravitySphere"), TEXT("Mixed") };
+
+	struct FBudgets
+	{
+		int32 WarmupTicks = 60;
+		int32 MeasuredTicks = 600;
+		TArray<int32> PawnCounts = { 1, 16, 64 };
+		//game thread budgets grow with the pawn count, Base + PerPawn * N
+		float MeanTickMsBase = 2.f;
+		float MeanTickMsPerPawn = 0.1f;
+		float PeakTickMsBase = 8.f;
+		float PeakTickMsPerPawn = 0.4f;
+		float QueriesPerPawnPerTick = 2.f;
+		float AllocationsPerPawnPerTick = 4.f;
+		float TransformUpdatesPerStep = 12.f;
+	};
+
+	FBudgets LoadBudgets()
+	{
+		FBudgets Budgets;
+		GConfig->GetInt(BudgetSection, TEXT("WarmupTicks"), Budgets.WarmupTicks, GGameIni);
+		GConfig->GetInt(BudgetSection, TEXT("MeasuredTicks"), Budgets.MeasuredTicks, GGameIni);
+		FString PawnCounts;
+		if(GConfig->GetString(BudgetSection, TEXT("PawnCounts"), PawnCounts, GGameIni))
+		{
+			TArray<FString> Counts;
+			PawnCounts.ParseIntoArray(Counts, TEXT(","));
+			Budgets.PawnCounts.Reset();
+			for(const FString& Count : Counts)
+			{
+				Budgets.PawnCounts.Add(FMath::Max(1, FCString::Atoi(*Count)));
+			}
+		}
+		GConfig->GetFloat(BudgetSection, TEXT("MeanTickMsBase"), Budgets.MeanTickMsBase, GGameIni);
+		GConfig->GetFloat(BudgetSection, TEXT("MeanTickMsPerPawn"), Budgets.MeanTickMsPerPawn, GGameIni);
+		GConfig->GetFloat(BudgetSection, TEXT("PeakTickMsBase"), Budgets.PeakTickMsBase, GGameIni);
+		GConfig->GetFloat(BudgetSection, TEXT("PeakTickMsPerPawn"), Budgets.PeakTickMsPerPawn, GGameIni);
+		GConfig->GetFloat(BudgetSection, TEXT("QueriesPerPawnPerTick"), Budgets.QueriesPerPawnPerTick, GGameIni);
+		GConfig->GetFloat(BudgetSection, TEXT("AllocationsPerPawnPerTick"), Budgets.AllocationsPerPawnPerTick, GGameIni);
+		GConfig->GetFloat(BudgetSection, TEXT("TransformUpdatesPerStep"), Budgets.TransformUpdatesPerStep, GGameIni);
+		return Budgets;
+	}
+
+	/**
+	 * Counts allocations on every thread while it's installed, everything else goes straight to the real allocator.
+	 * Memory from before the swap is freed through here too, which is fine since the allocator underneath is the same.
+	 */
+	class FCountingMalloc final : public FMalloc
+	{
+	public:
+		explicit FCountingMalloc(FMalloc* InInnerMalloc) : InnerMalloc(InInnerMalloc) {}
+
+		virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+		{
+			NumAllocations.fetch_add(1, std::memory_order_relaxed);
+			return InnerMalloc->Malloc(Count, Alignment);
+		}
+		virtual void* TryMalloc(SIZE_T Count, uint32 Alignment) override
+		{
+			NumAllocations.fetch_add(1, std::memory_order_relaxed);
+			return InnerMalloc->TryMalloc(Count, Alignment);
+		}
+		virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			NumAllocations.fetch_add(1, std::memory_order_relaxed);
+			return InnerMalloc->Realloc(Original, Count, Alignment);
+		}
+		virtual void* TryRealloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			NumAllocations.fetch_add(1, std::memory_order_relaxed);
+			return InnerMalloc->TryRealloc(Original, Count, Alignment);
+		}
+		virtual void Free(void* Original) override { InnerMalloc->Free(Original); }
+		virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return InnerMalloc->QuantizeSize(Count, Alignment); }
+		virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return InnerMalloc->GetAllocationSize(Original, SizeOut); }
+		virtual void Trim(bool bTrimThreadCaches) override { InnerMalloc->Trim(bTrimThreadCaches); }
+		virtual void SetupTLSCachesOnCurrentThread() override { InnerMalloc->SetupTLSCachesOnCurrentThread(); }
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override { InnerMalloc->ClearAndDisableTLSCachesOnCurrentThread(); }
+		virtual bool IsInternallyThreadSafe() const override { return InnerMalloc->IsInternallyThreadSafe(); }
+		virtual bool ValidateHeap() override { return InnerMalloc->ValidateHeap(); }
+		virtual void UpdateStats() override { InnerMalloc->UpdateStats(); }
+		virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override { InnerMalloc->GetAllocatorStats(OutStats); }
+		virtual void DumpAllocatorStats(FOutputDevice& Ar) override { InnerMalloc->DumpAllocatorStats(Ar); }
+		virtual const TCHAR* GetDescriptiveName() override { return InnerMalloc->GetDescriptiveName(); }
+
+		FMalloc* InnerMalloc;
+		std::atomic<uint64> NumAllocations{0};
+	};
+
+	class FScopedAllocationCounter
+	{
+	public:
+		FScopedAllocationCounter()
+		{
+			//never freed, another thread can still be holding the pointer after it's swapped back
+			static FCountingMalloc* CountingMalloc = new FCountingMalloc(GMalloc);
+			Counter = CountingMalloc;
+			Counter->NumAllocations.store(0, std::memory_order_relaxed);
+			GMalloc = Counter;
+		}
+		~FScopedAllocationCounter()
+		{
+			GMalloc = Counter->InnerMalloc;
+		}
+		uint64 Num() const { return Counter->NumAllocations.load(std::memory_order_relaxed); }
+
+	private:
+		FCountingMalloc* Counter;
+	};
+
+	UWorld* CreateWorld()
+	{
+		UWorld* World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("GravityPerfTestWorld"));
+		FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+		WorldContext.SetCurrentWorld(World);
+		World->InitializeActorsForPlay(FURL());
+		World->BeginPlay();
+		return World;
+	}
+
+	void DestroyWorld(UWorld* World)
+	{
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+	}
+
+	void SpawnLayout(UWorld* World, const FString& Layout)
+	{
+		const bool bMixed = Layout == TEXT("Mixed");
+		if(bMixed || Layout == TEXT("GravitySphere"))
+		{
+			if(UClass* GravitySphereClass = LoadClass<AActor>(nullptr, GravitySphereClassPath))
+			{
+				World->SpawnActor<AActor>(GravitySphereClass, FTransform::Identity);
+			}
+		}
+		if(bMixed || Layout == TEXT("Floors"))
+		{
+			if(UClass* FloorClass = LoadClass<AActor>(nullptr, FloorClassPath))
+			{
+				for(int32 X = -2; X <= 2; X++)
+				{
+					for(int32 Y = -2; Y <= 2; Y++)
+					{
+						World->SpawnActor<AActor>(FloorClass, FTransform(FVector(X * 4000.f, Y * 4000.f, -1500.f)));
+					}
+				}
+			}
+		}
+		if(bMixed || Layout == TEXT("SphereFloors"))
+		{
+			if(UClass* SphereFloorClass = LoadClass<AActor>(nullptr, SphereFloorClassPath))
+			{
+				for(int32 SphereIndex = 0; SphereIndex < 12; SphereIndex++)
+				{
+					const FVector Direction = FRotator(FMath::Fmod(SphereIndex * 47.f, 120.f) - 60.f, SphereIndex * 30.f, 0.f).Vector();
+					World->SpawnActor<AActor>(SphereFloorClass, FTransform(Direction * 6000.f));
+				}
+			}
+		}
+	}
+
+	TArray<ABasePawnPlayer*> SpawnPawns(UWorld* World, const int32 Count)
+	{
+		TArray<ABasePawnPlayer*> Pawns;
+		UClass* PawnClass = LoadClass<ABasePawnPlayer>(nullptr, PawnClassPath);
+		if(PawnClass == nullptr)
+		{
+			return Pawns;
+		}
+		for(int32 PawnIndex = 0; PawnIndex < Count; PawnIndex++)
+		{
+			//a spiral through the layout, nobody starts inside anybody else
+			const float Angle = PawnIndex * 2.39996f;
+			const FVector Location(FMath::Cos(Angle) * (1000.f + PawnIndex * 150.f), FMath::Sin(Angle) * (1000.f + PawnIndex * 150.f), 500.f + (PawnIndex % 4) * 400.f);
+			ABasePawnPlayer* Pawn = World->SpawnActorDeferred<ABasePawnPlayer>(PawnClass, FTransform(Location), nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+			if(Pawn == nullptr)
+			{
+				continue;
+			}
+			//possessed before BeginPlay so the pawn sets itself up as locally controlled
+			Pawn->AutoPossessAI = EAutoPossessAI::Spawned;
+			Pawn->AIControllerClass = APlayerController::StaticClass();
+			Pawn->FinishSpawning(FTransform(Location));
+			Pawns.Add(Pawn);
+		}
+		return Pawns;
+	}
+
+	void DriveInput(const TArray<ABasePawnPlayer*>& Pawns, const int32 Tick)
+	{
+		for(int32 PawnIndex = 0; PawnIndex < Pawns.Num(); PawnIndex++)
+		{
+			//the same script every run, offset per pawn so they don't all jump on the same tick
+			const int32 PawnTick = Tick + PawnIndex * 37;
+			const int32 Phase = (PawnTick / 90) % 4;
+			const FVector MoveVector = Phase == 0 ? FVector(1.f, 0.f, 0.f) : Phase == 1 ? FVector(0.f, 1.f, 0.f) : Phase == 2 ? FVector(-1.f, 0.f, 0.f) : FVector(0.7f, -0.7f, 0.f);
+			const FVector2D Look(FMath::Sin(PawnTick * 0.05f), FMath::Cos(PawnTick * 0.03f) * 0.5f);
+			Pawns[PawnIndex]->InjectInput(MoveVector, Look, PawnTick % 120 == 0, PawnTick % 300 == 150, PawnTick % 240 == 60);
+		}
+	}
+}
+
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FGravityMovementPerfTest, "Gravity.Perf.Movement", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+void FGravityMovementPerfTest::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	const GravityPerfTest::FBudgets Budgets = GravityPerfTest::LoadBudgets();
+	for(const TCHAR* Layout : GravityPerfTest::Layouts)
+	{
+		for(const int32 PawnCount : Budgets.PawnCounts)
+		{
+			OutBeautifiedNames.Add(FString::Printf(TEXT("%s x%d"), Layout, PawnCount));
+			OutTestCommands.Add(FString::Printf(TEXT("%s %d"), Layout, PawnCount));
+		}
+	}
+}
+
+bool FGravityMovementPerfTest::RunTest(const FString& Parameters)
+{
+	FString Layout;
+	FString PawnCountString;
+	if(!Parameters.Split(TEXT(" "), &Layout, &PawnCountString))
+	{
+		AddError(FString::Printf(TEXT("Bad parameters '%s'"), *Parameters));
+		return false;
+	}
+	const int32 PawnCount = FCString::Atoi(*PawnCountString);
+	const GravityPerfTest::FBudgets Budgets = GravityPerfTest::LoadBudgets();
+
+	UWorld* World = GravityPerfTest::CreateWorld();
+	GravityPerfTest::SpawnLayout(World, Layout);
+	const TArray<ABasePawnPlayer*> Pawns = GravityPerfTest::SpawnPawns(World, PawnCount);
+	if(!TestEqual(TEXT("Spawned pawns"), Pawns.Num(), PawnCount))
+	{
+		GravityPerfTest::DestroyWorld(World);
+		return false;
+	}
+
+	const float DeltaTime = 1.f/60.f;
+	for(int32 Tick = 0; Tick < Budgets.WarmupTicks; Tick++)
+	{
+		GravityPerfTest::DriveInput(Pawns, Tick);
+		World->Tick(LEVELTICK_All, DeltaTime);
+	}
+
+	double TotalTickSeconds = 0.0;
+	double PeakTickSeconds = 0.0;
+	uint64 NumAllocations = 0;
+	const uint32 QueriesBefore = FShooterWorldQuery::GetNumQueriesRun();
+	const uint32 StepsBefore = ABasePawnPlayer::GetNumMovementSteps();
+	const uint32 TransformUpdatesBefore = ABasePawnPlayer::GetNumComponentTransformUpdates();
+	for(int32 Tick = 0; Tick < Budgets.MeasuredTicks; Tick++)
+	{
+		GravityPerfTest::DriveInput(Pawns, Budgets.WarmupTicks + Tick);
+		GravityPerfTest::FScopedAllocationCounter AllocationCounter;
+		const double TickStart = FPlatformTime::Seconds();
+		World->Tick(LEVELTICK_All, DeltaTime);
+		const double TickSeconds = FPlatformTime::Seconds() - TickStart;
+		NumAllocations += AllocationCounter.Num();
+		TotalTickSeconds += TickSeconds;
+		PeakTickSeconds = FMath::Max(PeakTickSeconds, TickSeconds);
+	}
+	const uint32 NumQueries = FShooterWorldQuery::GetNumQueriesRun() - QueriesBefore;
+	const uint32 NumSteps = ABasePawnPlayer::GetNumMovementSteps() - StepsBefore;
+	const uint32 NumTransformUpdates = ABasePawnPlayer::GetNumComponentTransformUpdates() - TransformUpdatesBefore;
+	GravityPerfTest::DestroyWorld(World);
+
+	const int32 MeasuredTicks = FMath::Max(1, Budgets.MeasuredTicks);
+	const float MeanTickMs = static_cast<float>(TotalTickSeconds * 1000.0 / MeasuredTicks);
+	const float PeakTickMs = static_cast<float>(PeakTickSeconds * 1000.0);
+	const float QueriesPerPawnPerTick = static_cast<float>(NumQueries) / (MeasuredTicks * PawnCount);
+	const float AllocationsPerPawnPerTick = static_cast<float>(NumAllocations) / (MeasuredTicks * PawnCount);
+	//per frame render smoothing is counted in too, it's spread over the steps
+	const float TransformUpdatesPerStep = static_cast<float>(NumTransformUpdates) / FMath::Max<uint32>(1, NumSteps);
+	AddInfo(FString::Printf(TEXT("%s x%d: mean %.3f ms, peak %.3f ms, %.2f queries and %.2f allocations per pawn per tick, %.2f component transform updates per step"),
+		*Layout, PawnCount, MeanTickMs, PeakTickMs, QueriesPerPawnPerTick, AllocationsPerPawnPerTick, TransformUpdatesPerStep));
+
+	TestTrue(FString::Printf(TEXT("Mean game thread tick %.3f ms within budget"), MeanTickMs), MeanTickMs <= Budgets.MeanTickMsBase + Budgets.MeanTickMsPerPawn * PawnCount);
+	TestTrue(FString::Printf(TEXT("Peak game thread tick %.3f ms within budget"), PeakTickMs), PeakTickMs <= Budgets.PeakTickMsBase + Budgets.PeakTickMsPerPawn * PawnCount);
+	TestTrue(FString::Printf(TEXT("%.2f floor queries per pawn per tick within budget"), QueriesPerPawnPerTick), QueriesPerPawnPerTick <= Budgets.QueriesPerPawnPerTick);
+	TestTrue(FString::Printf(TEXT("%.2f allocations per pawn per tick within budget"), AllocationsPerPawnPerTick), AllocationsPerPawnPerTick <= Budgets.AllocationsPerPawnPerTick);
+	TestTrue(FString::Printf(TEXT("%.2f component transform updates per step within budget"), TransformUpdatesPerStep), TransformUpdatesPerStep <= Budgets.TransformUpdatesPerStep);
+	return true;
+}
+
+#endif
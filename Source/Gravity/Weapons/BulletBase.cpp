@@ -6,6 +6,7 @@
 #include "Components/BoxComponent.h"
 #include "GameFramework/ProjectileMovementComponent.h"
 #include "Gravity/Characters/BasePawnPlayer.h"
+#include "Gravity/Weapons/WeaponBase.h"
 #include "Kismet/GameplayStatics.h"
 
 ABulletBase::ABulletBase()
@@ -21,24 +22,97 @@ void ABulletBase::BeginPlay()
 {
 	Super::BeginPlay();
 
-	//this isn't setting it, putting it in tick does. might need to make a pollinit in the future if shooting yourself becomes a problem
-	BulletBox->MoveIgnoreActors.Add(GetOwner());
 	BulletBox->OnComponentHit.AddDynamic(this, &ABulletBase::OnBulletHit);
+	//pawns are hit through their hit boxes, a capsule would stop the bullet before it reaches them
+	BulletBox->SetCollisionResponseToChannel(ECC_Pawn, ECR_Ignore);
+	LastLocation = GetActorLocation();
+	if(!Pool.IsValid())
+	{
+		//spawned outside a pool, the owner was only set after spawning so BeginPlay can't ignore it
+		BulletBox->IgnoreActorWhenMoving(GetOwner(), true);
+		GetWorldTimerManager().SetTimer(LifetimeTimer, this, &ABulletBase::DeactivateBullet, BulletLifetime);
+	}
+}
+
+void ABulletBase::ActivateBullet(const FVector& Location, const FRotator& Rotation, AActor* Shooter)
+{
+	SetOwner(Shooter);
+	//the shooter can change between shots, so the ignore list is rebuilt every time the bullet is armed
+	BulletBox->ClearMoveIgnoreActors();
+	BulletBox->IgnoreActorWhenMoving(Shooter, true);
+	BulletBox->IgnoreActorWhenMoving(Pool.Get(), true);
+	SetActorLocationAndRotation(Location, Rotation, false, nullptr, ETeleportType::ResetPhysics);
+	LastLocation = Location;
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+	SetActorTickEnabled(true);
+	BulletMovement->SetUpdatedComponent(BulletBox);
+	BulletMovement->Velocity = Rotation.Vector() * BulletMovement->InitialSpeed;
+	BulletMovement->Activate(true);
+	BulletMovement->UpdateComponentVelocity();
+	bBulletActive = true;
+	GetWorldTimerManager().SetTimer(LifetimeTimer, this, &ABulletBase::DeactivateBullet, BulletLifetime);
+}
+
+void ABulletBase::DeactivateBullet()
+{
+	GetWorldTimerManager().ClearTimer(LifetimeTimer);
+	AWeaponBase* Weapon = Pool.Get();
+	if(Weapon == nullptr)
+	{
+		Destroy();
+		return;
+	}
+	if(!bBulletActive)
+	{
+		return;
+	}
+	bBulletActive = false;
+	BulletMovement->StopMovementImmediately();
+	BulletMovement->Deactivate();
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+	SetActorTickEnabled(false);
+	Weapon->ReleaseBullet(this);
 }
 
 void ABulletBase::OnBulletHit(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
 {
-	ABasePawnPlayer* Shooter = Cast<ABasePawnPlayer>(OtherActor);
-	if(Shooter)
+	//a pawn in front of the wall is hit first
+	if(HitPawnHitboxes(Hit.Location))
+	{
+		return;
+	}
+	DeactivateBullet();
+}
+
+bool ABulletBase::HitPawnHitboxes(const FVector& SegmentEnd)
+{
+	const FVector SegmentStart = LastLocation;
+	LastLocation = SegmentEnd;
+	AWeaponBase* Weapon = Pool.Get();
+	const ABasePawnPlayer* Shooter = Cast<ABasePawnPlayer>(GetOwner());
+	const FVector Segment = SegmentEnd - SegmentStart;
+	const float SegmentLength = static_cast<float>(Segment.Size());
+	if(!HasAuthority() || !bBulletActive || Weapon == nullptr || Shooter == nullptr || SegmentLength <= KINDA_SMALL_NUMBER)
 	{
-		UGameplayStatics::ApplyDamage(OtherActor, BulletDamage, Shooter->Controller, this,  UDamageType::StaticClass());
+		return false;
 	}
-	Destroy();
+	//the bullet lives on the server, the boxes are checked where they are now
+	FShooterHitboxRayHit BoxHit;
+	ABasePawnPlayer* HitPawn = Weapon->RaycastPawnHitboxes(SegmentStart, Segment / SegmentLength, SegmentLength, Shooter->GetServerWorldTime(), BoxHit);
+	if(HitPawn == nullptr)
+	{
+		return false;
+	}
+	UGameplayStatics::ApplyDamage(HitPawn, BulletDamage, Shooter->GetController(), this, UDamageType::StaticClass());
+	DeactivateBullet();
+	return true;
 }
 
 void ABulletBase::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
-
+	HitPawnHitboxes(GetActorLocation());
 }
 
@@ -8,6 +8,7 @@
 
 class UProjectileMovementComponent;
 class UBoxComponent;
+class AWeaponBase;
 UCLASS()
 class GRAVITY_API ABulletBase : public AActor
 {
@@ -16,6 +17,12 @@ class GRAVITY_API ABulletBase : public AActor
 public:	
 	ABulletBase();
 	virtual void Tick(float DeltaTime) override;
+
+	//pooled bullets are spawned parked by their weapon and armed again for every shot
+	void ActivateBullet(const FVector& Location, const FRotator& Rotation, AActor* Shooter);
+	void DeactivateBullet();
+	FORCEINLINE bool IsBulletActive() const { return bBulletActive; }
+	FORCEINLINE void SetPool(AWeaponBase* Weapon) { Pool = Weapon; }
 	
 protected:
 	virtual void BeginPlay() override;
@@ -29,8 +36,18 @@ private:
 
 	UFUNCTION()
 	void OnBulletHit(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit);
+	//pawns have no hit box components, the server checks their hit boxes along every stretch the bullet moves
+	bool HitPawnHitboxes(const FVector& SegmentEnd);
+	FVector LastLocation = FVector::ZeroVector;
 	UPROPERTY(EditAnywhere)
 	float BulletDamage = 20.f;
+	//a bullet that hasn't hit anything by now goes back to the pool
+	UPROPERTY(EditAnywhere)
+	float BulletLifetime = 3.f;
+
+	TWeakObjectPtr<AWeaponBase> Pool;
+	FTimerHandle LifetimeTimer;
+	bool bBulletActive = true;
 
 public:	
 
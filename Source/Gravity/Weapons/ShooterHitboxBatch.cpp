@@ -0,0 +1,159 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterHitboxBatch.h"
+
+#include "Math/VectorRegister.h"
+
+namespace ShooterHitboxBatch
+{
+	constexpr int32 LaneCount = 4;
+
+	//v + w * t + u x t with t = 2 * (u x v), u and w being the quaternion's vector and scalar parts
+	FORCEINLINE void RotateVector(
+		const VectorRegister4Float& QuatX, const VectorRegister4Float& QuatY, const VectorRegister4Float& QuatZ, const VectorRegister4Float& QuatW,
+		const VectorRegister4Float& X, const VectorRegister4Float& Y, const VectorRegister4Float& Z,
+		VectorRegister4Float& OutX, VectorRegister4Float& OutY, VectorRegister4Float& OutZ)
+	{
+		const VectorRegister4Float Two = VectorSetFloat1(2.f);
+		const VectorRegister4Float TX = VectorMultiply(Two, VectorSubtract(VectorMultiply(QuatY, Z), VectorMultiply(QuatZ, Y)));
+		const VectorRegister4Float TY = VectorMultiply(Two, VectorSubtract(VectorMultiply(QuatZ, X), VectorMultiply(QuatX, Z)));
+		const VectorRegister4Float TZ = VectorMultiply(Two, VectorSubtract(VectorMultiply(QuatX, Y), VectorMultiply(QuatY, X)));
+		OutX = VectorAdd(VectorMultiplyAdd(QuatW, TX, X), VectorSubtract(VectorMultiply(QuatY, TZ), VectorMultiply(QuatZ, TY)));
+		OutY = VectorAdd(VectorMultiplyAdd(QuatW, TY, Y), VectorSubtract(VectorMultiply(QuatZ, TX), VectorMultiply(QuatX, TZ)));
+		OutZ = VectorAdd(VectorMultiplyAdd(QuatW, TZ, Z), VectorSubtract(VectorMultiply(QuatX, TY), VectorMultiply(QuatY, TX)));
+	}
+
+	//narrows [Near, Far] to where the ray is between one pair of faces
+	FORCEINLINE void ClipSlab(const VectorRegister4Float& Start, const VectorRegister4Float& Direction, const VectorRegister4Float& Extent,
+		VectorRegister4Float& Near, VectorRegister4Float& Far)
+	{
+		//a ray parallel to the faces gets a tiny step instead, it's inside the slab everywhere or nowhere
+		const VectorRegister4Float Epsilon = VectorSetFloat1(KINDA_SMALL_NUMBER);
+		const VectorRegister4Float SafeDirection = VectorSelect(VectorCompareLT(VectorAbs(Direction), Epsilon), Epsilon, Direction);
+		const VectorRegister4Float InverseDirection = VectorDivide(VectorSetFloat1(1.f), SafeDirection);
+		const VectorRegister4Float Enter = VectorMultiply(VectorSubtract(VectorNegate(Extent), Start), InverseDirection);
+		const VectorRegister4Float Exit = VectorMultiply(VectorSubtract(Extent, Start), InverseDirection);
+		Near = VectorMax(Near, VectorMin(Enter, Exit));
+		Far = VectorMin(Far, VectorMax(Enter, Exit));
+	}
+}
+
+void FShooterHitboxBatch::Reset(const FVector& InOrigin)
+{
+	Origin = InOrigin;
+	NumBoxes = 0;
+	CenterX.Reset();
+	CenterY.Reset();
+	CenterZ.Reset();
+	InverseQuatX.Reset();
+	InverseQuatY.Reset();
+	InverseQuatZ.Reset();
+	InverseQuatW.Reset();
+	ExtentX.Reset();
+	ExtentY.Reset();
+	ExtentZ.Reset();
+	Owners.Reset();
+	Hitboxes.Reset();
+}
+
+void FShooterHitboxBatch::AddFrame(const FShooterHitboxFrame& Frame, const int32 Owner)
+{
+	for(int32 Hitbox = 0; Hitbox < ShooterNumHitboxes; Hitbox++)
+	{
+		AddBox(Frame.Boxes[Hitbox], Owner, Hitbox);
+	}
+}
+
+void FShooterHitboxBatch::AddBox(const FShooterHitbox& Box, const int32 Owner, const int32 Hitbox)
+{
+	using namespace ShooterHitboxBatch;
+	if(NumBoxes % LaneCount == 0)
+	{
+		//a whole register at a time, the unused lanes are never reported
+		const int32 NumLanes = NumBoxes + LaneCount;
+		for(FLaneArray* Lanes : {&CenterX, &CenterY, &CenterZ, &InverseQuatX, &InverseQuatY, &InverseQuatZ, &InverseQuatW, &ExtentX, &ExtentY, &ExtentZ})
+		{
+			Lanes->SetNumZeroed(NumLanes, false);
+		}
+	}
+	const FVector Center = Box.Center - Origin;
+	CenterX[NumBoxes] = static_cast<float>(Center.X);
+	CenterY[NumBoxes] = static_cast<float>(Center.Y);
+	CenterZ[NumBoxes] = static_cast<float>(Center.Z);
+	InverseQuatX[NumBoxes] = static_cast<float>(-Box.Rotation.X);
+	InverseQuatY[NumBoxes] = static_cast<float>(-Box.Rotation.Y);
+	InverseQuatZ[NumBoxes] = static_cast<float>(-Box.Rotation.Z);
+	InverseQuatW[NumBoxes] = static_cast<float>(Box.Rotation.W);
+	ExtentX[NumBoxes] = static_cast<float>(Box.Extent.X);
+	ExtentY[NumBoxes] = static_cast<float>(Box.Extent.Y);
+	ExtentZ[NumBoxes] = static_cast<float>(Box.Extent.Z);
+	Owners.Add(Owner);
+	Hitboxes.Add(Hitbox);
+	NumBoxes++;
+}
+
+bool FShooterHitboxBatch::RaycastClosest(const FVector& Start, const FVector& Direction, const float MaxDistance, FShooterHitboxRayHit& OutHit, const int32 IgnoredOwner) const
+{
+	using namespace ShooterHitboxBatch;
+	const FVector LocalStart = Start - Origin;
+	const VectorRegister4Float StartX = VectorSetFloat1(static_cast<float>(LocalStart.X));
+	const VectorRegister4Float StartY = VectorSetFloat1(static_cast<float>(LocalStart.Y));
+	const VectorRegister4Float StartZ = VectorSetFloat1(static_cast<float>(LocalStart.Z));
+	const VectorRegister4Float DirectionX = VectorSetFloat1(static_cast<float>(Direction.X));
+	const VectorRegister4Float DirectionY = VectorSetFloat1(static_cast<float>(Direction.Y));
+	const VectorRegister4Float DirectionZ = VectorSetFloat1(static_cast<float>(Direction.Z));
+	const VectorRegister4Float Zero = VectorSetFloat1(0.f);
+
+	float ClosestDistance = MaxDistance;
+	int32 ClosestBox = INDEX_NONE;
+	for(int32 First = 0; First < NumBoxes; First += LaneCount)
+	{
+		const VectorRegister4Float QuatX = VectorLoadAligned(&InverseQuatX[First]);
+		const VectorRegister4Float QuatY = VectorLoadAligned(&InverseQuatY[First]);
+		const VectorRegister4Float QuatZ = VectorLoadAligned(&InverseQuatZ[First]);
+		const VectorRegister4Float QuatW = VectorLoadAligned(&InverseQuatW[First]);
+
+		//the ray in each box's space
+		VectorRegister4Float BoxStartX, BoxStartY, BoxStartZ;
+		RotateVector(QuatX, QuatY, QuatZ, QuatW,
+			VectorSubtract(StartX, VectorLoadAligned(&CenterX[First])),
+			VectorSubtract(StartY, VectorLoadAligned(&CenterY[First])),
+			VectorSubtract(StartZ, VectorLoadAligned(&CenterZ[First])),
+			BoxStartX, BoxStartY, BoxStartZ);
+		VectorRegister4Float BoxDirectionX, BoxDirectionY, BoxDirectionZ;
+		RotateVector(QuatX, QuatY, QuatZ, QuatW, DirectionX, DirectionY, DirectionZ, BoxDirectionX, BoxDirectionY, BoxDirectionZ);
+
+		//anything past the closest hit so far can't win
+		VectorRegister4Float Near = Zero;
+		VectorRegister4Float Far = VectorSetFloat1(ClosestDistance);
+		ClipSlab(BoxStartX, BoxDirectionX, VectorLoadAligned(&ExtentX[First]), Near, Far);
+		ClipSlab(BoxStartY, BoxDirectionY, VectorLoadAligned(&ExtentY[First]), Near, Far);
+		ClipSlab(BoxStartZ, BoxDirectionZ, VectorLoadAligned(&ExtentZ[First]), Near, Far);
+
+		const int32 HitLanes = VectorMaskBits(VectorCompareLE(Near, Far));
+		if(HitLanes == 0)
+		{
+			continue;
+		}
+		alignas(16) float NearDistances[LaneCount];
+		VectorStoreAligned(Near, NearDistances);
+		const int32 NumLanes = FMath::Min(LaneCount, NumBoxes - First);
+		for(int32 Lane = 0; Lane < NumLanes; Lane++)
+		{
+			if((HitLanes & (1 << Lane)) && NearDistances[Lane] <= ClosestDistance && Owners[First + Lane] != IgnoredOwner)
+			{
+				ClosestDistance = NearDistances[Lane];
+				ClosestBox = First + Lane;
+			}
+		}
+	}
+	if(ClosestBox == INDEX_NONE)
+	{
+		return false;
+	}
+	OutHit.Owner = Owners[ClosestBox];
+	OutHit.Hitbox = Hitboxes[ClosestBox];
+	OutHit.Distance = ClosestDistance;
+	return true;
+}
@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Gravity/Weapons/ShooterHitboxHistory.h"
+
+struct FShooterHitboxRayHit
+{
+	//whatever was passed to AddFrame for the pawn that was hit
+	int32 Owner = INDEX_NONE;
+	//which of the pawn's hit boxes, GetShooterHitboxBoneName has its bone
+	int32 Hitbox = INDEX_NONE;
+	float Distance = 0.f;
+};
+
+/**
+ * The hit boxes of any number of pawns as flat arrays, four boxes to a vector register.
+ * A ray is tested against every box in one pass with no physics scene involved.
+ * Positions are kept as floats relative to Origin, so put it near where the rays start.
+ */
+class GRAVITY_API FShooterHitboxBatch
+{
+public:
+	void Reset(const FVector& InOrigin = FVector::ZeroVector);
+	void AddFrame(const FShooterHitboxFrame& Frame, int32 Owner);
+	void AddBox(const FShooterHitbox& Box, int32 Owner, int32 Hitbox);
+	FORCEINLINE int32 Num() const { return NumBoxes; }
+
+	/**
+	 * Closest box the unit Direction enters within MaxDistance of Start, skipping IgnoredOwner's boxes.
+	 * Safe to call from several threads at once.
+	 */
+	bool RaycastClosest(const FVector& Start, const FVector& Direction, float MaxDistance, FShooterHitboxRayHit& OutHit, int32 IgnoredOwner = INDEX_NONE) const;
+
+private:
+	using FLaneArray = TArray<float, TAlignedHeapAllocator<16>>;
+
+	FVector Origin = FVector::ZeroVector;
+	int32 NumBoxes = 0;
+	FLaneArray CenterX;
+	FLaneArray CenterY;
+	FLaneArray CenterZ;
+	//the inverse rotation, so the kernel goes from world into box space without conjugating
+	FLaneArray InverseQuatX;
+	FLaneArray InverseQuatY;
+	FLaneArray InverseQuatZ;
+	FLaneArray InverseQuatW;
+	FLaneArray ExtentX;
+	FLaneArray ExtentY;
+	FLaneArray ExtentZ;
+	TArray<int32> Owners;
+	TArray<int32> Hitboxes;
+};
@@ -0,0 +1,130 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/StaticArray.h"
+
+//one per hit box component on ABasePawnPlayer, in the order it builds them, the head first
+static constexpr int32 ShooterNumHitboxes = 15;
+static constexpr int32 ShooterHeadHitbox = 0;
+
+//the bone each hit box follows, by hit box index
+inline FName GetShooterHitboxBoneName(const int32 Hitbox)
+{
+	static const FName BoneNames[ShooterNumHitboxes] = {
+		TEXT("Head"), TEXT("Spine2"), TEXT("Hips"),
+		TEXT("RightUpLeg"), TEXT("LeftUpLeg"), TEXT("RightLeg"), TEXT("LeftLeg"), TEXT("RightFoot"), TEXT("LeftFoot"),
+		TEXT("RightArm"), TEXT("LeftArm"), TEXT("RightForeArm"), TEXT("LeftForeArm"), TEXT("RightHand"), TEXT("LeftHand") };
+	return BoneNames[Hitbox];
+}
+
+struct FShooterHitbox
+{
+	FVector Center = FVector::ZeroVector;
+	FQuat Rotation = FQuat::Identity;
+	//half size, already scaled
+	FVector Extent = FVector::ZeroVector;
+};
+
+//where a hit box sits on its bone, everything needed to rebuild it from the pose
+struct FShooterHitboxShape
+{
+	int32 BoneIndex = INDEX_NONE;
+	FTransform BoxToBone = FTransform::Identity;
+	FVector UnscaledExtent = FVector::ZeroVector;
+};
+
+struct FShooterHitboxFrame
+{
+	float ServerTime = 0.f;
+	//a sphere around every box, shots that miss it don't look at the boxes
+	FVector BoundsCenter = FVector::ZeroVector;
+	float BoundsRadius = 0.f;
+	TStaticArray<FShooterHitbox, ShooterNumHitboxes> Boxes;
+};
+
+/**
+ * Where a pawn's hit boxes were over the last second or so of server time, recorded on the server.
+ * Hitscan shots are checked against the boxes as they were when the shooter fired, not where they are now.
+ */
+class FShooterHitboxHistory
+{
+public:
+	static constexpr int32 Capacity = 64;
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity has to be a power of two");
+
+	FORCEINLINE int32 Num() const { return Count; }
+	FORCEINLINE bool IsEmpty() const { return Count == 0; }
+	FORCEINLINE const FShooterHitboxFrame& operator[](const int32 Index) const { return Frames[(Head + Index) & (Capacity - 1)]; }
+	FORCEINLINE const FShooterHitboxFrame& Last() const { return (*this)[Count - 1]; }
+
+	//frames that aren't newer than the last one are dropped, the oldest is overwritten once it's full
+	void Add(const FShooterHitboxFrame& Frame)
+	{
+		if(Count > 0 && Frame.ServerTime <= Last().ServerTime)
+		{
+			return;
+		}
+		if(Count == Capacity)
+		{
+			Head = (Head + 1) & (Capacity - 1);
+			Count--;
+		}
+		Frames[(Head + Count) & (Capacity - 1)] = Frame;
+		Count++;
+	}
+
+	/**
+	 * The boxes at ServerTime, blended between the two frames around it.
+	 * Times outside the history are held at the oldest or newest frame, there's no extrapolation.
+	 */
+	bool Sample(const float ServerTime, FShooterHitboxFrame& OutFrame) const
+	{
+		if(Count == 0)
+		{
+			return false;
+		}
+		if(ServerTime <= (*this)[0].ServerTime)
+		{
+			OutFrame = (*this)[0];
+			return true;
+		}
+		if(ServerTime >= Last().ServerTime)
+		{
+			OutFrame = Last();
+			return true;
+		}
+		for(int32 Index = Count - 1; Index > 0; Index--)
+		{
+			const FShooterHitboxFrame& From = (*this)[Index - 1];
+			if(From.ServerTime <= ServerTime)
+			{
+				const FShooterHitboxFrame& To = (*this)[Index];
+				const float Alpha = (ServerTime - From.ServerTime) / (To.ServerTime - From.ServerTime);
+				OutFrame.ServerTime = ServerTime;
+				OutFrame.BoundsCenter = FMath::Lerp(From.BoundsCenter, To.BoundsCenter, Alpha);
+				OutFrame.BoundsRadius = FMath::Max(From.BoundsRadius, To.BoundsRadius);
+				for(int32 Box = 0; Box < ShooterNumHitboxes; Box++)
+				{
+					OutFrame.Boxes[Box].Center = FMath::Lerp(From.Boxes[Box].Center, To.Boxes[Box].Center, Alpha);
+					OutFrame.Boxes[Box].Rotation = FQuat::Slerp(From.Boxes[Box].Rotation, To.Boxes[Box].Rotation, Alpha);
+					OutFrame.Boxes[Box].Extent = FMath::Lerp(From.Boxes[Box].Extent, To.Boxes[Box].Extent, Alpha);
+				}
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void Reset()
+	{
+		Head = 0;
+		Count = 0;
+	}
+
+private:
+	TStaticArray<FShooterHitboxFrame, Capacity> Frames;
+	int32 Head = 0;
+	int32 Count = 0;
+};
@@ -5,12 +5,23 @@
 
 #include "BulletBase.h"
 #include "Components/SphereComponent.h"
+#include "Components/StaticMeshComponent.h"
 #include "Components/TextBlock.h"
+#include "Engine/BlueprintGeneratedClass.h"
+#include "Engine/SCS_Node.h"
+#include "Engine/SimpleConstructionScript.h"
 #include "Engine/SkeletalMeshSocket.h"
+#include "EngineUtils.h"
+#include "Gravity/Gravity.h"
+#include "Gravity/GravityStats.h"
 #include "Gravity/Characters/BasePawnPlayer.h"
 #include "Gravity/HUD/ShooterHUD.h"
 #include "Gravity/HUD/UShooterOverlay.h"
 #include "Gravity/PlayerController/GravityPlayerController.h"
+#include "Gravity/Subsystems/GravityProjectileSubsystem.h"
+#include "Gravity/Weapons/ShooterHitboxBatch.h"
+#include "Kismet/GameplayStatics.h"
+#include "VisualLogger/VisualLogger.h"
 
 AWeaponBase::AWeaponBase()
 {
@@ -29,8 +40,161 @@ void AWeaponBase::BeginPlay()
 	WeaponPickupSphere->OnComponentBeginOverlap.AddDynamic(this, &AWeaponBase::ShowPickupWidget);
 	WeaponPickupSphere->OnComponentEndOverlap.AddDynamic(this, &AWeaponBase::HidePickupWidget);
 	Shooter = Cast<ABasePawnPlayer>(GetOwner());
+	if(FireMode == EWeaponFireMode::Projectile && ProjectileParams.Mesh == nullptr)
+	{
+		ProjectileParams.Mesh = FindBulletMesh();
+	}
 }
 
+void AWeaponBase::WarmBulletPool()
+{
+	if(FireMode != EWeaponFireMode::BulletActor || BulletPool.Num() > 0)
+	{
+		return;
+	}
+	for(int32 BulletIndex = 0; BulletIndex < BulletPoolSize; BulletIndex++)
+	{
+		if(ABulletBase* Bullet = SpawnPooledBullet())
+		{
+			Bullet->DeactivateBullet();
+		}
+	}
+}
+
+void AWeaponBase::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	for(ABulletBase* Bullet : BulletPool)
+	{
+		if(IsValid(Bullet))
+		{
+			Bullet->SetPool(nullptr);
+			Bullet->Destroy();
+		}
+	}
+	BulletPool.Reset();
+	AvailableBullets.Reset();
+	Super::EndPlay(EndPlayReason);
+}
+
+ABulletBase* AWeaponBase::SpawnPooledBullet()
+{
+	UWorld* World = GetWorld();
+	if(BulletClass == nullptr || World == nullptr)
+	{
+		return nullptr;
+	}
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.Owner = GetOwner();
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.bDeferConstruction = true;
+	ABulletBase* Bullet = World->SpawnActor<ABulletBase>(BulletClass, GetActorTransform(), SpawnParams);
+	if(Bullet)
+	{
+		//the pool has to be known before BeginPlay, a pooled bullet doesn't arm itself there
+		Bullet->SetPool(this);
+		//pooled bullets only exist on the machine that fired them, a replicated copy would have no pool to return to
+		Bullet->SetReplicates(false);
+		Bullet->FinishSpawning(GetActorTransform());
+		BulletPool.Add(Bullet);
+	}
+	return Bullet;
+}
+
+void AWeaponBase::ReleaseBullet(ABulletBase* Bullet)
+{
+	AvailableBullets.Add(Bullet);
+}
+
+UStaticMesh* AWeaponBase::FindBulletMesh() const
+{
+	//the bullet blueprint's mesh is only on its construction script, not the class default object
+	for(UClass* Class = BulletClass; Class; Class = Class->GetSuperClass())
+	{
+		const UBlueprintGeneratedClass* BlueprintClass = Cast<UBlueprintGeneratedClass>(Class);
+		if(BlueprintClass == nullptr || BlueprintClass->SimpleConstructionScript == nullptr)
+		{
+			continue;
+		}
+		for(const USCS_Node* Node : BlueprintClass->SimpleConstructionScript->GetAllNodes())
+		{
+			if(const UStaticMeshComponent* MeshComponent = Cast<UStaticMeshComponent>(Node->ComponentTemplate))
+			{
+				return MeshComponent->GetStaticMesh();
+			}
+		}
+	}
+	return nullptr;
+}
+
+void AWeaponBase::LaunchProjectile(const FGravityProjectileSpawn& Spawn, const bool bDealsDamage)
+{
+	if(UGravityProjectileSubsystem* Projectiles = GetWorld()->GetSubsystem<UGravityProjectileSubsystem>())
+	{
+		Projectiles->LaunchProjectile(ProjectileParams, Spawn.Origin, Spawn.Direction, GetOwner(), bDealsDamage);
+	}
+}
+
+void AWeaponBase::ConfirmHitscan(const FGravityProjectileSpawn& Shot, const float FireServerTime)
+{
+	GRAVITY_SCOPE_CYCLE_COUNTER(STAT_GravityHitscan);
+	UWorld* World = GetWorld();
+	const FVector Start = Shot.Origin;
+	const FVector Direction = FVector(Shot.Direction).GetSafeNormal();
+	if(World == nullptr || Direction.IsNearlyZero())
+	{
+		return;
+	}
+	//the level isn't rewound, it still stops the shot where it is now
+	float HitDistance = HitscanParams.Range;
+	FHitResult WorldHit;
+	const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(GravityHitscan), false, GetOwner());
+	if(World->LineTraceSingleByObjectType(WorldHit, Start, Start + Direction * HitDistance, FCollisionObjectQueryParams(ECC_WorldStatic), QueryParams))
+	{
+		HitDistance = WorldHit.Distance;
+	}
+
+	FShooterHitboxRayHit BoxHit;
+	ABasePawnPlayer* HitPawn = RaycastPawnHitboxes(Start, Direction, HitDistance, FireServerTime, BoxHit);
+	const bool bHitPawn = HitPawn != nullptr;
+	if(bHitPawn)
+	{
+		HitDistance = BoxHit.Distance;
+	}
+	UE_VLOG_SEGMENT(GetOwner(), LogGravity, Log, Start, Start + Direction * HitDistance, bHitPawn ? FColor::Red : FColor::White,
+		TEXT("Hitscan at %.3f %s"), FireServerTime, bHitPawn ? *GetShooterHitboxBoneName(BoxHit.Hitbox).ToString() : TEXT(""));
+	if(bHitPawn)
+	{
+		const float Damage = HitscanParams.Damage * (BoxHit.Hitbox == ShooterHeadHitbox ? HitscanParams.HeadshotMultiplier : 1.f);
+		const APawn* ShooterPawn = Cast<APawn>(GetOwner());
+		UGameplayStatics::ApplyDamage(HitPawn, Damage, ShooterPawn ? ShooterPawn->GetController() : nullptr, GetOwner(), UDamageType::StaticClass());
+	}
+}
+
+ABasePawnPlayer* AWeaponBase::RaycastPawnHitboxes(const FVector& Start, const FVector& Direction, const float MaxDistance, const float ServerTime, FShooterHitboxRayHit& OutHit)
+{
+	//only pawns whose bounds the ray passes through go in the batch
+	HitscanCandidates.Reset();
+	HitscanBatch.Reset(Start);
+	FShooterHitboxFrame Frame;
+	for(TActorIterator<ABasePawnPlayer> It(GetWorld()); It; ++It)
+	{
+		ABasePawnPlayer* Candidate = *It;
+		if(Candidate == GetOwner() || !Candidate->GetRewoundHitboxes(ServerTime, Frame))
+		{
+			continue;
+		}
+		if(FMath::PointDistToSegmentSquared(Frame.BoundsCenter, Start, Start + Direction * MaxDistance) > FMath::Square(Frame.BoundsRadius))
+		{
+			continue;
+		}
+		HitscanBatch.AddFrame(Frame, HitscanCandidates.Add(Candidate));
+	}
+	if(!HitscanBatch.RaycastClosest(Start, Direction, MaxDistance, OutHit))
+	{
+		return nullptr;
+	}
+	return HitscanCandidates[OutHit.Owner];
+}
 
 void AWeaponBase::Tick(float DeltaTime)
 {
@@ -72,17 +236,79 @@ void AWeaponBase::HidePickupWidget(UPrimitiveComponent* OverlappedComponent, AAc
 	}
 }
 
+bool AWeaponBase::ConsumeServerShot()
+{
+	//every shot takes its interval up front, idle time only counts for FireBurstTolerance shots
+	const float Now = GetWorld()->GetTimeSeconds();
+	const float EarliestShotTime = FMath::Max(NextServerShotTime, Now - FireInterval * FireBurstTolerance);
+	if(EarliestShotTime > Now)
+	{
+		UE_VLOG(this, LogGravity, Warning, TEXT("Shot dropped, %.3f s early"), EarliestShotTime - Now);
+		return false;
+	}
+	NextServerShotTime = EarliestShotTime + FireInterval;
+	return true;
+}
+
+FVector AWeaponBase::GetMuzzleLocation() const
+{
+	const USkeletalMeshSocket* Muzzle = WeaponBodyMesh->GetSocketByName(FName("MuzzleFlash"));
+	return Muzzle ? Muzzle->GetSocketLocation(WeaponBodyMesh) : GetActorLocation();
+}
+
 void AWeaponBase::RequestFire(FVector HitTarget)
 {
 	Shooter = Shooter == nullptr ? Cast<ABasePawnPlayer>(GetOwner()) : Shooter;
 	UWorld* World = GetWorld();
+	if(World == nullptr || World->GetTimeSeconds() - LastFireTime < FireInterval)
+	{
+		return;
+	}
+	LastFireTime = World->GetTimeSeconds();
 	const USkeletalMeshSocket* Muzzle = WeaponBodyMesh->GetSocketByName(FName("MuzzleFlash"));
-	if(Shooter && BulletClass && Muzzle && World)
+	if(Shooter && FireMode == EWeaponFireMode::Hitscan && Muzzle && World)
+	{
+		const FVector MuzzleLocation = Muzzle->GetSocketLocation(WeaponBodyMesh);
+		FGravityProjectileSpawn Shot;
+		Shot.Origin = MuzzleLocation;
+		Shot.Direction = (HitTarget - MuzzleLocation).GetSafeNormal();
+		if(Shooter->HasAuthority())
+		{
+			//the server sees everyone where they are now
+			ConfirmHitscan(Shot, Shooter->GetServerWorldTime());
+		}
+		else
+		{
+			//other pawns are drawn in the past, that's the moment the shooter aimed at
+			Shooter->ServerFireHitscan(Shot, Shooter->GetProxyRenderTime());
+		}
+	}
+	else if(Shooter && FireMode == EWeaponFireMode::Projectile && Muzzle && World)
+	{
+		const FVector MuzzleLocation = Muzzle->GetSocketLocation(WeaponBodyMesh);
+		FGravityProjectileSpawn Spawn;
+		Spawn.Origin = MuzzleLocation;
+		Spawn.Direction = (HitTarget - MuzzleLocation).GetSafeNormal();
+		//the shooter sees their shot straight away, the server's copy is the one that hits
+		LaunchProjectile(Spawn, Shooter->HasAuthority());
+		if(Shooter->HasAuthority())
+		{
+			Shooter->MulticastFireProjectile(Spawn);
+		}
+		else
+		{
+			Shooter->ServerFireProjectile(Spawn);
+		}
+	}
+	else if(Shooter && FireMode == EWeaponFireMode::BulletActor && BulletClass && Muzzle && World)
 	{
-		ABulletBase* Bullet = World->SpawnActor<ABulletBase>(BulletClass, Muzzle->GetSocketLocation(WeaponBodyMesh), (HitTarget - Muzzle->GetSocketLocation(WeaponBodyMesh)).Rotation());
+		//the owner wasn't known to be local when the weapon was equipped
+		WarmBulletPool();
+		ABulletBase* Bullet = AvailableBullets.Num() > 0 ? AvailableBullets.Pop(false) : SpawnPooledBullet();
 		if(Bullet)
 		{
-			Bullet->SetOwner(Shooter);
+			const FVector MuzzleLocation = Muzzle->GetSocketLocation(WeaponBodyMesh);
+			Bullet->ActivateBullet(MuzzleLocation, (HitTarget - MuzzleLocation).Rotation(), Shooter);
 		}
 	}
 }
@@ -4,6 +4,8 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "Gravity/GravityTypes/GravityProjectileTypes.h"
+#include "Gravity/Weapons/ShooterHitboxBatch.h"
 #include "WeaponBase.generated.h"
 
 class ABulletBase;
@@ -33,8 +35,24 @@ public:
 	
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	UPROPERTY(EditAnywhere)
 	TSubclassOf<ABulletBase> BulletClass;
+	//bullets spawned up front, sustained fire past this many in the air grows the pool
+	UPROPERTY(EditAnywhere)
+	int32 BulletPoolSize = 16;
+	UPROPERTY(EditAnywhere)
+	EWeaponFireMode FireMode = EWeaponFireMode::Projectile;
+	//shortest time between two shots, the server drops a client's shots that come faster
+	UPROPERTY(EditAnywhere)
+	float FireInterval = 0.1f;
+	//how many shots' worth of idle time the server saves up, so shots bunched up by jitter aren't dropped
+	UPROPERTY(EditAnywhere)
+	float FireBurstTolerance = 1.f;
+	UPROPERTY(EditAnywhere, meta=(EditCondition="FireMode == EWeaponFireMode::Projectile"))
+	FGravityProjectileParams ProjectileParams;
+	UPROPERTY(EditAnywhere, meta=(EditCondition="FireMode == EWeaponFireMode::Hitscan"))
+	FGravityHitscanParams HitscanParams;
 
 private:
 	UPROPERTY()
@@ -46,6 +64,19 @@ private:
 	UPROPERTY(EditAnywhere)
 	USphereComponent* WeaponPickupSphere;
 
+	UPROPERTY()
+	TArray<ABulletBase*> BulletPool;
+	UPROPERTY()
+	TArray<ABulletBase*> AvailableBullets;
+	float LastFireTime = -FLT_MAX;
+	float NextServerShotTime = -FLT_MAX;
+	ABulletBase* SpawnPooledBullet();
+	UStaticMesh* FindBulletMesh() const;
+
+	//kept between shots so confirming one doesn't allocate
+	FShooterHitboxBatch HitscanBatch;
+	TArray<ABasePawnPlayer*> HitscanCandidates;
+
 	UFUNCTION()
 	void ShowPickupWidget(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult & SweepResult);
 	UFUNCTION()
@@ -53,5 +84,18 @@ private:
 	
 public:	
 	void RequestFire(FVector HitTarget);
+	//server only, false if a client's shot came sooner than the fire interval allows
+	bool ConsumeServerShot();
+	//fills the bullet pool up front, only the machine that fires the weapon needs one and only in BulletActor mode
+	void WarmBulletPool();
+	void ReleaseBullet(ABulletBase* Bullet);
+	//where shots leave the barrel, the weapon's own location if the mesh has no muzzle socket
+	FVector GetMuzzleLocation() const;
+	//damage only comes from the server's own launch, everyone else's is for show
+	void LaunchProjectile(const FGravityProjectileSpawn& Spawn, bool bDealsDamage);
+	//server only, the shot is traced against every other pawn's hit boxes rewound to FireServerTime
+	void ConfirmHitscan(const FGravityProjectileSpawn& Shot, float FireServerTime);
+	//server only, the closest hit box of any pawn but our owner along the ray, with the boxes as they were at ServerTime
+	ABasePawnPlayer* RaycastPawnHitboxes(const FVector& Start, const FVector& Direction, float MaxDistance, float ServerTime, FShooterHitboxRayHit& OutHit);
 
 };